@@ -16,22 +16,50 @@ ByteBuffer::ByteBuffer(int mark, size_t pos, size_t lim, size_t cap, char* hb, s
     this->offset = offset;
 }
 
-ByteBuffer::ByteBuffer(size_t cap, size_t lim) : ByteBuffer(-1, 0, lim, cap, new char[cap](), 0) { released = false; }
+ByteBuffer::ByteBuffer(size_t cap, size_t lim) : ByteBuffer(-1, 0, lim, cap, new char[cap](), 0) {
+    storage.reset(hb, std::default_delete<char[]>());
+}
 
 ByteBuffer::ByteBuffer(size_t bufsize, char* buf, size_t off, size_t len)
     : ByteBuffer(-1, off, off + len, bufsize, buf, 0) {}
 
-ByteBuffer::~ByteBuffer() {
-    if (!released) {
-        delete[] hb;
-        released = true;
-    }
-}
+ByteBuffer::~ByteBuffer() {}
 
 ByteBuffer::ByteBuffer(const ByteBuffer& that)
-    : ByteBuffer(that._mark, that._position, that._limit, that._capacity, new char[that._capacity](), that.offset) {
-    memcpy(hb, that.hb, that._capacity);
-    released = false;
+    : ByteBuffer(that._mark, that._position, that._limit, that._capacity, new char[that._capacity](), 0) {
+    storage.reset(hb, std::default_delete<char[]>());
+    memcpy(hb, &that.hb[that.offset], that._capacity);
+    _order = that._order;
+}
+
+ByteBuffer::ByteBuffer(ByteBuffer&& that) noexcept
+    : _mark(that._mark), _position(that._position), _limit(that._limit), _capacity(that._capacity),
+      _order(that._order), hb(that.hb), offset(that.offset), storage(std::move(that.storage)) {
+    that._mark = -1;
+    that._position = that._limit = that._capacity = that.offset = 0;
+    that.hb = nullptr;
+}
+
+ByteBuffer& ByteBuffer::operator=(const ByteBuffer& that) {
+    if (this != &that) *this = ByteBuffer(that);
+    return *this;
+}
+
+ByteBuffer& ByteBuffer::operator=(ByteBuffer&& that) noexcept {
+    if (this != &that) {
+        _mark = that._mark;
+        _position = that._position;
+        _limit = that._limit;
+        _capacity = that._capacity;
+        _order = that._order;
+        hb = that.hb;
+        offset = that.offset;
+        storage = std::move(that.storage);
+        that._mark = -1;
+        that._position = that._limit = that._capacity = that.offset = 0;
+        that.hb = nullptr;
+    }
+    return *this;
 }
 
 size_t ByteBuffer::nextGetIndex() {
@@ -63,19 +91,10 @@ size_t ByteBuffer::checkIndex(size_t i) {
     return i;
 }
 
-size_t ByteBuffer::checkIndex(size_t i, size_t nb) {
-    if (nb > _limit - i) throw std::out_of_range("");
-    return i;
-}
-
 int ByteBuffer::markValue() { return _mark; }
 
 void ByteBuffer::discardMark() { _mark = -1; }
 
-size_t ByteBuffer::ix(size_t i) {
-    return i; // no offset
-}
-
 void ByteBuffer::checkBounds(int off, int len, int size) {
     if ((off | len | (off + len) | (size - (off + len))) < 0) throw std::out_of_range("");
 }
@@ -95,7 +114,7 @@ char* ByteBuffer::array() { return hb; }
 size_t ByteBuffer::arrayOffset() { return offset; }
 
 ByteBuffer& ByteBuffer::compact() {
-    memcpy(hb, &(hb[ix(position())]), remaining());
+    memmove(&hb[ix(0)], &(hb[ix(position())]), remaining());
     position(remaining());
     limit(capacity());
     discardMark();
@@ -120,6 +139,20 @@ ByteBuffer& ByteBuffer::clear() {
     return *this;
 }
 
+ByteBuffer ByteBuffer::duplicate() {
+    ByteBuffer dup(_mark, _position, _limit, _capacity, hb, offset);
+    dup.storage = storage;
+    dup._order = _order;
+    return dup;
+}
+
+ByteBuffer ByteBuffer::slice() {
+    ByteBuffer view(-1, 0, remaining(), remaining(), hb, ix(_position));
+    view.storage = storage;
+    view._order = _order;
+    return view;
+}
+
 ByteBuffer& ByteBuffer::flip() {
     _limit = _position;
     _position = 0;
@@ -203,6 +236,13 @@ ByteBuffer& ByteBuffer::putNTBS(std::string str) {
     return put(const_cast<char*>(str.data()), str.size()).put((char)0x00);
 }
 
+ByteOrder ByteBuffer::order() { return _order; }
+
+ByteBuffer& ByteBuffer::order(ByteOrder newOrder) {
+    _order = newOrder;
+    return *this;
+}
+
 size_t ByteBuffer::limit() { return _limit; }
 
 ByteBuffer& ByteBuffer::limit(size_t newLimit) {
@@ -222,7 +262,7 @@ ByteBuffer& ByteBuffer::mark() {
 char* ByteBuffer::output() {
     size_t length = remaining();
     char* dst = new char[length]();
-    memcpy(dst, &hb[_position], length);
+    memcpy(dst, &hb[ix(_position)], length);
     return dst;
 }
 
@@ -251,7 +291,7 @@ ByteBuffer& ByteBuffer::rewind() {
     return *this;
 }
 
-char& ByteBuffer::operator[](size_t idx) { return hb[idx]; }
+char& ByteBuffer::operator[](size_t idx) { return hb[ix(idx)]; }
 
 bool ByteBuffer::operator==(const ByteBuffer& rhs) { return equals(const_cast<ByteBuffer&>(rhs)); }
 
@@ -5,19 +5,24 @@
 #include <iterator>
 #include <string>
 #include <cstring>
+#include <memory>
 
 namespace lemlib {
 
+enum class ByteOrder { LittleEndian, BigEndian };
+
 class ByteBuffer {
     private:
         int _mark = -1;
         size_t _position = 0;
         size_t _limit;
         size_t _capacity;
+        ByteOrder _order = nativeOrder();
 
         char* hb;
         size_t offset = 0;
-        bool released = true;
+        // owns hb for allocated buffers and is shared by their slices and duplicates; empty for wrapped arrays
+        std::shared_ptr<char> storage;
 
         ByteBuffer(int mark, size_t pos, size_t lim, size_t cap, char* hb, size_t offset);
         ByteBuffer(size_t cap, size_t lim);
@@ -36,13 +41,27 @@ class ByteBuffer {
         size_t ix(size_t i);
 
         static void checkBounds(int off, int len, int size);
+
+        template <class T> T fromOrder(T value);
     public:
+        static constexpr ByteOrder nativeOrder() {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            return ByteOrder::BigEndian;
+#else
+            return ByteOrder::LittleEndian;
+#endif
+        }
+
         static ByteBuffer allocate(size_t capacity);
         static ByteBuffer wrap(size_t arrsize, char* array);
         static ByteBuffer wrap(size_t arrsize, char* array, size_t offset, size_t length);
 
         ~ByteBuffer();
+        // copies are deep, use duplicate() or slice() to share the content
         ByteBuffer(const ByteBuffer& that);
+        ByteBuffer(ByteBuffer&& that) noexcept;
+        ByteBuffer& operator=(const ByteBuffer& that);
+        ByteBuffer& operator=(ByteBuffer&& that) noexcept;
 
         char* array();
         size_t arrayOffset();
@@ -52,20 +71,27 @@ class ByteBuffer {
         int compareTo(ByteBuffer& that);
         // this method does not actually erase the data in the buffer
         ByteBuffer& clear();
-        // no duplicate();
+        // shares the content, with its own position, limit and mark
+        ByteBuffer duplicate();
         ByteBuffer& flip();
         bool equals(ByteBuffer& that);
         template <class T> T get();
         template <class T> T get(size_t idx);
+        // reads count values of T from position into dst
+        template <class T> ByteBuffer& getArray(T* dst, size_t count);
         char get();
         char get(size_t idx);
         ByteBuffer& get(char* dst, size_t offset, size_t length);
         ByteBuffer& get(char* dst, size_t length);
         std::string getNTBS(size_t maxSize = 1024);
         bool hasRemaining();
-        // no order()
+        // the byte order of multi-byte values, the native order by default
+        ByteOrder order();
+        ByteBuffer& order(ByteOrder newOrder);
         template <class T> ByteBuffer& put(T value);
         template <class T> ByteBuffer& put(size_t index, T value);
+        // writes count values of T from src at position
+        template <class T> ByteBuffer& putArray(const T* src, size_t count);
         ByteBuffer& put(char value);
         ByteBuffer& put(ByteBuffer& src);
         ByteBuffer& put(size_t index, char value);
@@ -84,56 +110,83 @@ class ByteBuffer {
         size_t remaining();
         ByteBuffer& reset();
         ByteBuffer& rewind();
-        // no slice()
+        // shares the content from position to limit, which becomes index 0 to capacity() of the slice
+        ByteBuffer slice();
 
-        char& operator[](size_t idx); // new, same as .array()[idx]
+        char& operator[](size_t idx); // new, same as .array()[arrayOffset() + idx]
         bool operator==(const ByteBuffer& rhs);
 };
 
-template <class T> ByteBuffer& ByteBuffer::put(T value) {
-    char* bytes = static_cast<char*>(static_cast<void*>(&value));
+// the hot helpers of the typed accessors are inline so a read costs one compare and one copy
 
-    return put(bytes, sizeof(T));
+inline size_t ByteBuffer::checkIndex(size_t i, size_t nb) {
+    if (i > _limit || nb > _limit - i) throw std::out_of_range("");
+    return i;
 }
 
-template <class T> inline ByteBuffer& ByteBuffer::put(size_t index, T value) {
-    char* bytes = static_cast<char*>(static_cast<void*>(&value));
-    size_t length = sizeof(T);
+inline size_t ByteBuffer::ix(size_t i) { return i + offset; }
 
-    /*for (size_t i = 0; i < sizeof(T); i++)
-        put(index + i, bytes[i]);*/
-    memcpy(&hb[ix(checkIndex(index))], bytes, length);
-    nextPutIndex(length);
+template <class T> inline T ByteBuffer::fromOrder(T value) {
+    if (_order == nativeOrder() || sizeof(T) == 1) return value;
+    char bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+    std::reverse(bytes, bytes + sizeof(T));
+    memcpy(&value, bytes, sizeof(T));
+    return value;
+}
 
+template <class T> inline ByteBuffer& ByteBuffer::put(T value) {
+    if (_limit - _position < sizeof(T)) throw std::overflow_error("");
+    value = fromOrder(value);
+    memcpy(&hb[ix(_position)], &value, sizeof(T));
+    _position += sizeof(T);
     return *this;
 }
 
-template <class T> inline T ByteBuffer::get() {
-    size_t length = sizeof(T);
+template <class T> inline ByteBuffer& ByteBuffer::put(size_t index, T value) {
+    checkIndex(index, sizeof(T));
+    value = fromOrder(value);
+    memcpy(&hb[ix(index)], &value, sizeof(T));
+    return *this;
+}
 
-    checkIndex(position(), length);
+template <class T> inline ByteBuffer& ByteBuffer::putArray(const T* src, size_t count) {
+    if (count > (_limit - _position) / sizeof(T)) throw std::overflow_error("");
+    char* dst = &hb[ix(_position)];
+    if (_order == nativeOrder()) {
+        memcpy(dst, src, count * sizeof(T));
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            T value = fromOrder(src[i]);
+            memcpy(dst + i * sizeof(T), &value, sizeof(T));
+        }
+    }
+    _position += count * sizeof(T);
+    return *this;
+}
 
-    char* buf = new char[sizeof(T)];
-    for (int i = 0; i < sizeof(T); i++) buf[i] = get();
+template <class T> inline T ByteBuffer::get() {
+    size_t i = checkIndex(_position, sizeof(T));
     T ans;
-    memcpy(&ans, buf, sizeof(T));
-    delete[] buf;
-
-    return ans;
+    memcpy(&ans, &hb[ix(i)], sizeof(T));
+    _position += sizeof(T);
+    return fromOrder(ans);
 }
 
 template <class T> inline T ByteBuffer::get(size_t idx) {
-    size_t length = sizeof(T);
-
-    checkIndex(idx, length);
-
-    char* buf = new char[sizeof(T)];
-    for (int i = 0; i < sizeof(T); i++) buf[i] = get(idx + i);
+    checkIndex(idx, sizeof(T));
     T ans;
-    memcpy(&ans, buf, sizeof(T));
-    delete[] buf;
+    memcpy(&ans, &hb[ix(idx)], sizeof(T));
+    return fromOrder(ans);
+}
 
-    return ans;
+template <class T> inline ByteBuffer& ByteBuffer::getArray(T* dst, size_t count) {
+    if (count > (_limit - _position) / sizeof(T)) throw std::underflow_error("");
+    memcpy(dst, &hb[ix(_position)], count * sizeof(T));
+    if (_order != nativeOrder())
+        for (size_t i = 0; i < count; i++) dst[i] = fromOrder(dst[i]);
+    _position += count * sizeof(T);
+    return *this;
 }
 
 } // namespace lemlib
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <stdexcept>
+#include "byteBufferBuilder.hpp"
+
+namespace lemlib {
+
+ChunkPool::ChunkPool(size_t chunkSize) : _chunkSize(chunkSize) {
+    if (chunkSize == 0) throw std::invalid_argument("chunkSize == 0");
+}
+
+ChunkPool::~ChunkPool() {
+    for (char* chunk : freeChunks) delete[] chunk;
+}
+
+char* ChunkPool::acquire() {
+    if (freeChunks.empty()) return new char[_chunkSize];
+    char* chunk = freeChunks.back();
+    freeChunks.pop_back();
+    return chunk;
+}
+
+void ChunkPool::release(char* chunk) { freeChunks.push_back(chunk); }
+
+ByteBufferBuilder::ByteBufferBuilder(size_t chunkSize) : ownPool(new ChunkPool(chunkSize)), pool(ownPool.get()) {}
+
+ByteBufferBuilder::ByteBufferBuilder(ChunkPool& pool) : pool(&pool) {}
+
+ByteBufferBuilder::~ByteBufferBuilder() { clear(); }
+
+void ByteBufferBuilder::nextChunk() {
+    chunks.push_back(pool->acquire());
+    used = 0;
+}
+
+ByteBufferBuilder& ByteBufferBuilder::order(ByteOrder newOrder) {
+    _order = newOrder;
+    return *this;
+}
+
+ByteBufferBuilder& ByteBufferBuilder::put(const char* src, size_t length) {
+    while (length > 0) {
+        if (chunks.empty() || used == pool->chunkSize()) nextChunk();
+        size_t n = std::min(length, pool->chunkSize() - used);
+        memcpy(chunks.back() + used, src, n);
+        used += n;
+        _size += n;
+        src += n;
+        length -= n;
+    }
+    return *this;
+}
+
+ByteBufferBuilder& ByteBufferBuilder::putNTBS(const std::string& str) {
+    return put(str.c_str(), str.size() + 1);
+}
+
+std::vector<ByteSegment> ByteBufferBuilder::segments() {
+    std::vector<ByteSegment> rtn;
+    rtn.reserve(chunks.size());
+    for (size_t i = 0; i < chunks.size(); i++)
+        rtn.push_back({chunks[i], i + 1 == chunks.size() ? used : pool->chunkSize()});
+    return rtn;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+std::vector<struct iovec> ByteBufferBuilder::iovecs() {
+    std::vector<struct iovec> rtn;
+    rtn.reserve(chunks.size());
+    for (const ByteSegment& segment : segments()) rtn.push_back({const_cast<char*>(segment.data), segment.size});
+    return rtn;
+}
+#endif
+
+void ByteBufferBuilder::copyTo(char* dst) {
+    for (const ByteSegment& segment : segments()) {
+        memcpy(dst, segment.data, segment.size);
+        dst += segment.size;
+    }
+}
+
+ByteBuffer ByteBufferBuilder::flatten() {
+    ByteBuffer rtn = ByteBuffer::allocate(_size);
+    copyTo(rtn.array() + rtn.arrayOffset());
+    return rtn;
+}
+
+void ByteBufferBuilder::clear() {
+    for (char* chunk : chunks) pool->release(chunk);
+    chunks.clear();
+    used = 0;
+    _size = 0;
+}
+
+} // namespace lemlib
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "byteBuffer.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/uio.h>
+#endif
+
+namespace lemlib {
+
+struct ByteSegment {
+        const char* data;
+        size_t size;
+};
+
+// Recycles fixed-size chunks between builders. Not thread-safe.
+class ChunkPool {
+    private:
+        size_t _chunkSize;
+        std::vector<char*> freeChunks;
+    public:
+        explicit ChunkPool(size_t chunkSize = 64 * 1024);
+        ~ChunkPool();
+
+        ChunkPool(const ChunkPool&) = delete;
+        ChunkPool& operator=(const ChunkPool&) = delete;
+
+        char* acquire();
+        void release(char* chunk);
+
+        size_t chunkSize() { return _chunkSize; }
+
+        size_t available() { return freeChunks.size(); }
+};
+
+// Appends into a chain of pooled chunks, so the output can grow without a capacity guess and without ever
+// moving bytes already written. The chunks are handed out as segments or flattened once at the end. Output whose size
+// is known before it is written, like a path file through encodedSize(), is better off in one buffer of that size.
+class ByteBufferBuilder {
+    private:
+        std::unique_ptr<ChunkPool> ownPool;
+        ChunkPool* pool;
+        std::vector<char*> chunks;
+        size_t used = 0; // bytes used in the last chunk
+        size_t _size = 0;
+        ByteOrder _order = ByteBuffer::nativeOrder();
+
+        void nextChunk();
+    public:
+        explicit ByteBufferBuilder(size_t chunkSize = 64 * 1024);
+        // takes its chunks from a pool shared with other builders, which must outlive this one
+        explicit ByteBufferBuilder(ChunkPool& pool);
+        ~ByteBufferBuilder();
+
+        ByteBufferBuilder(const ByteBufferBuilder&) = delete;
+        ByteBufferBuilder& operator=(const ByteBufferBuilder&) = delete;
+
+        ByteOrder order() { return _order; }
+
+        ByteBufferBuilder& order(ByteOrder newOrder);
+
+        template <class T> ByteBufferBuilder& put(T value);
+        ByteBufferBuilder& put(const char* src, size_t length);
+        ByteBufferBuilder& putNTBS(const std::string& str);
+
+        size_t size() { return _size; }
+
+        std::vector<ByteSegment> segments();
+#if defined(__unix__) || defined(__APPLE__)
+        std::vector<struct iovec> iovecs();
+#endif
+        // copies everything into dst, which must hold size() bytes
+        void copyTo(char* dst);
+        // a single allocated buffer holding everything, with position 0 and limit size()
+        ByteBuffer flatten();
+
+        // gives all chunks back to the pool
+        void clear();
+};
+
+template <class T> inline ByteBufferBuilder& ByteBufferBuilder::put(T value) {
+    if (_order != ByteBuffer::nativeOrder() && sizeof(T) > 1) {
+        char bytes[sizeof(T)];
+        memcpy(bytes, &value, sizeof(T));
+        std::reverse(bytes, bytes + sizeof(T));
+        memcpy(&value, bytes, sizeof(T));
+    }
+
+    if (!chunks.empty() && pool->chunkSize() - used >= sizeof(T)) {
+        memcpy(chunks.back() + used, &value, sizeof(T));
+        used += sizeof(T);
+        _size += sizeof(T);
+        return *this;
+    }
+
+    return put(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+} // namespace lemlib
@@ -0,0 +1,156 @@
+#include <cstring>
+#include "crc32c.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LEMLIB_PATH_CRC32C_SSE42
+#include <immintrin.h>
+#endif
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// reflected Castagnoli polynomial
+constexpr uint32_t polynomial = 0x82F63B78;
+
+struct Crc32cTables {
+        uint32_t slice[8][256] = {};
+        uint32_t byteShift = 0; // x^8 mod polynomial
+        uint32_t inverseByteShift = 0; // x^-8 mod polynomial
+};
+
+// x^-1, the polynomial without its x^32 term divided by x, as the polynomial has an x^0 term
+constexpr uint32_t inverseX = (polynomial << 1) | 1;
+
+// a * b mod polynomial, with bit 31 as the coefficient of x^0
+constexpr uint32_t multiply(uint32_t a, uint32_t b) {
+    uint32_t product = 0;
+    for (uint32_t m = 1u << 31; m != 0; m >>= 1) {
+        if (a & m) product ^= b;
+        b = b & 1 ? (b >> 1) ^ polynomial : b >> 1;
+    }
+    return product;
+}
+
+constexpr Crc32cTables makeTables() {
+    Crc32cTables t;
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int k = 0; k < 8; k++) crc = crc & 1 ? (crc >> 1) ^ polynomial : crc >> 1;
+        t.slice[0][i] = crc;
+    }
+    for (int k = 1; k < 8; k++)
+        for (uint32_t i = 0; i < 256; i++)
+            t.slice[k][i] = (t.slice[k - 1][i] >> 8) ^ t.slice[0][t.slice[k - 1][i] & 0xFF];
+
+    t.byteShift = 1u << 30; // x^1
+    t.inverseByteShift = inverseX;
+    for (int k = 0; k < 3; k++) {
+        t.byteShift = multiply(t.byteShift, t.byteShift);
+        t.inverseByteShift = multiply(t.inverseByteShift, t.inverseByteShift);
+    }
+    return t;
+}
+
+static constexpr Crc32cTables tables = makeTables();
+static_assert(multiply(inverseX, 1u << 30) == 1u << 31, "x^-1 * x is not 1");
+
+// base^bytes mod polynomial by squaring. The powers x^(2^k) do not repeat with a period of 32 for this polynomial,
+// so they are squared for every bit of bytes rather than looked up in a fixed size table.
+static uint32_t power(uint32_t base, size_t bytes) {
+    uint32_t p = 1u << 31; // x^0
+    for (; bytes != 0; bytes >>= 1, base = multiply(base, base))
+        if (bytes & 1) p = multiply(base, p);
+    return p;
+}
+
+// x^(8 * bytes) mod polynomial
+static uint32_t bytePower(size_t bytes) { return power(tables.byteShift, bytes); }
+
+// x^(-8 * bytes) mod polynomial
+static uint32_t inverseBytePower(size_t bytes) { return power(tables.inverseByteShift, bytes); }
+
+// The raw register update, without the inversion before and after. The register after appending n zero bytes is
+// multiply(bytePower(n), register), which is what combining and patching rely on.
+static uint32_t updateSoftware(uint32_t crc, const uint8_t* p, size_t n) {
+    for (; n >= 8; n -= 8, p += 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = tables.slice[7][lo & 0xFF] ^ tables.slice[6][(lo >> 8) & 0xFF] ^ tables.slice[5][(lo >> 16) & 0xFF] ^
+              tables.slice[4][lo >> 24] ^ tables.slice[3][hi & 0xFF] ^ tables.slice[2][(hi >> 8) & 0xFF] ^
+              tables.slice[1][(hi >> 16) & 0xFF] ^ tables.slice[0][hi >> 24];
+    }
+    for (; n > 0; n--) crc = (crc >> 8) ^ tables.slice[0][(crc ^ *p++) & 0xFF];
+    return crc;
+}
+
+#ifdef LEMLIB_PATH_CRC32C_SSE42
+
+// crc32 has a latency of 3 cycles and a throughput of 1, so three independent streams keep it busy
+constexpr size_t streamSize = 4096;
+
+__attribute__((target("sse4.2"))) static uint32_t updateSSE42(uint32_t crc, const uint8_t* p, size_t n) {
+    static const uint32_t shift1 = bytePower(streamSize);
+    static const uint32_t shift2 = bytePower(2 * streamSize);
+
+    uint64_t c0 = crc;
+    for (; n >= 3 * streamSize; n -= 3 * streamSize, p += 3 * streamSize) {
+        uint64_t c1 = 0, c2 = 0;
+        for (size_t i = 0; i < streamSize; i += 8) {
+            uint64_t w0, w1, w2;
+            memcpy(&w0, p + i, 8);
+            memcpy(&w1, p + streamSize + i, 8);
+            memcpy(&w2, p + 2 * streamSize + i, 8);
+            c0 = _mm_crc32_u64(c0, w0);
+            c1 = _mm_crc32_u64(c1, w1);
+            c2 = _mm_crc32_u64(c2, w2);
+        }
+        c0 = multiply(shift2, (uint32_t)c0) ^ multiply(shift1, (uint32_t)c1) ^ (uint32_t)c2;
+    }
+    for (; n >= 8; n -= 8, p += 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        c0 = _mm_crc32_u64(c0, w);
+    }
+    uint32_t c = (uint32_t)c0;
+    for (; n > 0; n--) c = _mm_crc32_u8(c, *p++);
+    return c;
+}
+
+#endif // LEMLIB_PATH_CRC32C_SSE42
+
+bool isCrc32cAccelerated() {
+#ifdef LEMLIB_PATH_CRC32C_SSE42
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+uint32_t crc32c(const uint8_t* data, size_t size, uint32_t crc) {
+#ifdef LEMLIB_PATH_CRC32C_SSE42
+    if (isCrc32cAccelerated()) return ~updateSSE42(~crc, data, size);
+#endif
+    return ~updateSoftware(~crc, data, size);
+}
+
+uint32_t crc32cSoftware(const uint8_t* data, size_t size, uint32_t crc) { return ~updateSoftware(~crc, data, size); }
+
+uint32_t crc32cCombine(uint32_t crcA, uint32_t crcB, size_t sizeB) { return multiply(bytePower(sizeB), crcA) ^ crcB; }
+
+uint32_t crc32cReplaceTail(uint32_t crc, uint32_t oldTail, size_t oldSize, uint32_t newTail, size_t newSize) {
+    // crc ^ oldTail is the checksum of the bytes before the tail moved past oldSize zero bytes; moving it back and
+    // forward again gives their part of the new checksum
+    return multiply(bytePower(newSize), multiply(inverseBytePower(oldSize), crc ^ oldTail)) ^ newTail;
+}
+
+uint32_t crc32cPatch(uint32_t crc, const uint8_t* diff, size_t size, size_t bytesAfter) {
+    // the checksum is affine in the message, so the change is the raw checksum of the difference moved past the
+    // bytes after it
+    return crc ^ multiply(bytePower(bytesAfter), updateSoftware(0, diff, size));
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// CRC32C (Castagnoli), the checksum of the file header; crc32c("123456789") == 0xE3069283. Pass the checksum of
+// the bytes before to continue it. Uses the SSE4.2 crc32 instruction on three interleaved streams when the CPU has
+// it, and slicing-by-8 tables otherwise.
+uint32_t crc32c(const uint8_t* data, size_t size, uint32_t crc = 0);
+// the table driven implementation, whatever the CPU supports
+uint32_t crc32cSoftware(const uint8_t* data, size_t size, uint32_t crc = 0);
+bool isCrc32cAccelerated();
+
+// the checksum of a followed by b, from the checksums of both and the size of b
+uint32_t crc32cCombine(uint32_t crcA, uint32_t crcB, size_t sizeB);
+// The checksum of a message after its last oldSize bytes, with the checksum oldTail, were replaced by newSize bytes
+// with the checksum newTail. Costs nothing beyond the two checksums of the tails, whatever came before them.
+uint32_t crc32cReplaceTail(uint32_t crc, uint32_t oldTail, size_t oldSize, uint32_t newTail, size_t newSize);
+// The checksum of a message after size bytes of it were xor-ed with diff, with bytesAfter bytes following them.
+// Costs the size of the change, not the size of the message.
+uint32_t crc32cPatch(uint32_t crc, const uint8_t* diff, size_t size, size_t bytesAfter);
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,57 @@
+#include "deltaCodec.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+const uint8_t* skipDelta(const uint8_t* src, const uint8_t* end, DeltaState& state) {
+    Waypoint w;
+    return decodeDelta(src, end, state, w);
+}
+
+size_t deltaRecordSize(const uint8_t* src, const uint8_t* end) {
+    if (src == end) return 0;
+    const uint8_t* p = src + 1;
+    for (size_t field = 0; field < format::fieldCount(*src); field++) {
+        // an overlong varint is cut at its maximum size; decodeDelta() rejects it
+        for (size_t i = 0; i < format::maxVarintSize; i++) {
+            if (p == end) return 0;
+            if ((*p++ & 0x80) == 0) break;
+        }
+    }
+    return p - src;
+}
+
+static uint16_t delta(int16_t value, int16_t& previous) {
+    const uint16_t d = format::zigzag((int16_t)(value - previous));
+    previous = value;
+    return d;
+}
+
+static uint16_t delta(uint16_t value, uint16_t& previous) {
+    const uint16_t d = format::zigzag((int16_t)(value - previous));
+    previous = value;
+    return d;
+}
+
+size_t encodedDeltaSize(const Waypoint& w, DeltaState& state) {
+    size_t size = 1;
+    size += format::varintSize(delta(w.x, state.x));
+    size += format::varintSize(delta(w.y, state.y));
+    size += format::varintSize(delta(w.speed, state.speed));
+    if (w.isHeadingAvailable) size += format::varintSize(delta(w.heading, state.heading));
+    if (w.isLookaheadAvailable) size += format::varintSize(delta(w.lookahead, state.lookahead));
+    return size;
+}
+
+uint8_t* encodeDelta(uint8_t* dst, const Waypoint& w, DeltaState& state) {
+    *dst++ = (w.isHeadingAvailable ? format::headingFlag : 0) | (w.isLookaheadAvailable ? format::lookaheadFlag : 0);
+    dst = format::storeVarint(dst, delta(w.x, state.x));
+    dst = format::storeVarint(dst, delta(w.y, state.y));
+    dst = format::storeVarint(dst, delta(w.speed, state.speed));
+    if (w.isHeadingAvailable) dst = format::storeVarint(dst, delta(w.heading, state.heading));
+    if (w.isLookaheadAvailable) dst = format::storeVarint(dst, delta(w.lookahead, state.lookahead));
+    return dst;
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "pathFileSystem.hpp"
+#include "pathFileFormat.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// The delta waypoint layout keeps the flag byte of the plain layout and stores x, y, speed, heading and lookahead
+// as zigzag varints of the difference to the same field of the previous waypoint that had it, wrapping at 16 bits
+// so every value round-trips. Unknown parameters are stored as zigzag varints of their value.
+struct DeltaState {
+        int16_t x = 0;
+        int16_t y = 0;
+        int16_t speed = 0;
+        uint16_t heading = 0;
+        int16_t lookahead = 0;
+};
+
+// decodes one record and advances state; nullptr if the record is malformed or runs past end
+const uint8_t* decodeDelta(const uint8_t* src, const uint8_t* end, DeltaState& state, Waypoint& w);
+// skips one record, still advancing state since later records depend on it
+const uint8_t* skipDelta(const uint8_t* src, const uint8_t* end, DeltaState& state);
+// the size of the record at src, or 0 if it is not complete before end
+size_t deltaRecordSize(const uint8_t* src, const uint8_t* end);
+
+size_t encodedDeltaSize(const Waypoint& w, DeltaState& state);
+uint8_t* encodeDelta(uint8_t* dst, const Waypoint& w, DeltaState& state);
+
+inline const uint8_t* decodeDelta(const uint8_t* src, const uint8_t* end, DeltaState& state, Waypoint& w) {
+    if (src == end) return nullptr;
+    const uint8_t flag = *src++;
+    uint16_t d;
+    if ((src = format::loadVarint(src, end, d)) == nullptr) return nullptr;
+    w.x = state.x = (int16_t)(state.x + format::unzigzag(d));
+    if ((src = format::loadVarint(src, end, d)) == nullptr) return nullptr;
+    w.y = state.y = (int16_t)(state.y + format::unzigzag(d));
+    if ((src = format::loadVarint(src, end, d)) == nullptr) return nullptr;
+    w.speed = state.speed = (int16_t)(state.speed + format::unzigzag(d));
+
+    if ((w.isHeadingAvailable = (flag & format::headingFlag) != 0)) {
+        if ((src = format::loadVarint(src, end, d)) == nullptr) return nullptr;
+        w.heading = state.heading = (uint16_t)(state.heading + format::unzigzag(d));
+    }
+    if ((w.isLookaheadAvailable = (flag & format::lookaheadFlag) != 0)) {
+        if ((src = format::loadVarint(src, end, d)) == nullptr) return nullptr;
+        w.lookahead = state.lookahead = (int16_t)(state.lookahead + format::unzigzag(d));
+    }
+
+    for (uint8_t unknown = flag >> 2; unknown != 0 && src != nullptr; unknown &= unknown - 1)
+        src = format::loadVarint(src, end, d);
+    return src;
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
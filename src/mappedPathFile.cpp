@@ -0,0 +1,93 @@
+#include <cerrno>
+#include "mappedPathFile.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LEMLIB_PATH_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lemlib {
+namespace PathFileSystem {
+
+MappedPathFile::MappedPathFile(const uint8_t* mapping, size_t length)
+    : mapping(mapping), length(length), opened(true) {}
+
+MappedPathFile::~MappedPathFile() { close(); }
+
+MappedPathFile::MappedPathFile(MappedPathFile&& that)
+    : mapping(that.mapping), length(that.length), opened(that.opened) {
+    that.mapping = nullptr;
+    that.length = 0;
+    that.opened = false;
+}
+
+MappedPathFile& MappedPathFile::operator=(MappedPathFile&& that) {
+    if (this != &that) {
+        close();
+        mapping = that.mapping;
+        length = that.length;
+        opened = that.opened;
+        that.mapping = nullptr;
+        that.length = 0;
+        that.opened = false;
+    }
+    return *this;
+}
+
+bool MappedPathFile::decode(PathFile& output) const {
+    if (!isOpen()) return false;
+    return PathFileSystem::decode(mapping, length, output);
+}
+
+void MappedPathFile::close() {
+#ifdef LEMLIB_PATH_HAS_MMAP
+    if (mapping != nullptr) munmap(const_cast<uint8_t*>(mapping), length);
+#endif
+    mapping = nullptr;
+    length = 0;
+    opened = false;
+}
+
+MappedPathFile open(const char* path, bool sequential) {
+#ifdef LEMLIB_PATH_HAS_MMAP
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return MappedPathFile();
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        const int error = errno;
+        ::close(fd);
+        errno = error;
+        return MappedPathFile();
+    }
+    // mmap() refuses a length of 0, yet an empty file opened fine
+    if (info.st_size == 0) {
+        ::close(fd);
+        return MappedPathFile(nullptr, 0);
+    }
+
+    size_t length = (size_t)info.st_size;
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    const int error = errno;
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        errno = error;
+        return MappedPathFile();
+    }
+
+    madvise(mapping, length, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    return MappedPathFile(static_cast<const uint8_t*>(mapping), length);
+#else
+    (void)path;
+    (void)sequential;
+    errno = ENOSYS;
+    return MappedPathFile();
+#endif
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "pathFileSystem.hpp"
+#include "pathFileView.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// A read-only memory mapping of a path file. Views and lazily decoded paths made from it stay valid as long
+// as the mapping does.
+class MappedPathFile {
+    private:
+        const uint8_t* mapping = nullptr; // nullptr for an empty file, which cannot be mapped
+        size_t length = 0;
+        bool opened = false;
+
+        MappedPathFile(const uint8_t* mapping, size_t length);
+
+        friend MappedPathFile open(const char* path, bool sequential);
+    public:
+        MappedPathFile() = default;
+        ~MappedPathFile();
+
+        MappedPathFile(const MappedPathFile&) = delete;
+        MappedPathFile& operator=(const MappedPathFile&) = delete;
+        MappedPathFile(MappedPathFile&& that);
+        MappedPathFile& operator=(MappedPathFile&& that);
+
+        bool isOpen() const { return opened; }
+
+        const uint8_t* data() const { return mapping; }
+
+        size_t size() const { return length; }
+
+        PathFileView view() const { return PathFileView(mapping, length); }
+
+        bool decode(PathFile& output) const;
+
+        void close();
+};
+
+// Maps the file read-only, hinting the kernel to read ahead when sequential is set. An empty file gives an open
+// mapping of size() 0 and no data(). On failure, or on platforms without mmap, the returned mapping is not open and
+// errno tells why.
+MappedPathFile open(const char* path, bool sequential = true);
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,46 @@
+#include "metadata.hpp"
+#include "pathFileFormat.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+bool MetadataReader::next(MetadataEntry& entry) {
+    if (error || ptr == end) return false;
+    if (end - ptr < 2 || (size_t)(end - ptr - 2) < ptr[1]) return error = true, false;
+    entry.key = ptr[0];
+    entry.value = {ptr + 2, ptr[1]};
+    ptr += 2 + ptr[1];
+    return true;
+}
+
+bool findMetadata(ByteSpan metadata, uint8_t key, ByteSpan& value) {
+    MetadataReader reader(metadata);
+    MetadataEntry entry;
+    while (reader.next(entry)) {
+        if (entry.key == key) return value = entry.value, true;
+    }
+    return false;
+}
+
+bool appendMetadata(std::pmr::vector<uint8_t>& metadata, uint8_t key, const void* value, size_t size) {
+    if (metadata.size() + 2 + size > UINT8_MAX) return false;
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    metadata.push_back(key);
+    metadata.push_back((uint8_t)size);
+    metadata.insert(metadata.end(), bytes, bytes + size);
+    return true;
+}
+
+void copyFileMetadata(ByteSpan fileMetadata, std::pmr::vector<uint8_t>& output) {
+    output.clear();
+    MetadataReader reader(fileMetadata);
+    MetadataEntry entry;
+    while (reader.next(entry)) {
+        if (entry.key == format::waypointEncodingTag) continue;
+        appendMetadata(output, entry.key, entry.value.data, entry.value.size);
+    }
+    if (reader.failed()) output.assign(fileMetadata.data, fileMetadata.data + fileMetadata.size);
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <vector>
+#include "pathFileView.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// File and path metadata is a list of entries: a 1-byte key, a 1-byte length and that many bytes of value, at most
+// 255 bytes in all. Key 0x01 of the file metadata is the waypoint encoding and is kept out of PathFile::metadata.
+struct MetadataEntry {
+        uint8_t key = 0;
+        ByteSpan value;
+};
+
+// Walks the entries of a metadata block in place, one per call to next(). Nothing is parsed until it is used.
+class MetadataReader {
+    private:
+        const uint8_t* ptr = nullptr;
+        const uint8_t* end = nullptr;
+        bool error = false;
+    public:
+        MetadataReader() = default;
+        explicit MetadataReader(ByteSpan metadata) : ptr(metadata.data), end(metadata.data + metadata.size) {}
+
+        // returns false at the end of the block or at an entry that runs past it
+        bool next(MetadataEntry& entry);
+
+        bool failed() const { return error; }
+};
+
+// the value of the first entry with the key, false if there is none
+bool findMetadata(ByteSpan metadata, uint8_t key, ByteSpan& value);
+
+// a value stored as a little-endian T, e.g. a float gain or a uint32_t timeout; false if absent or of another size
+template <class T> bool findMetadata(ByteSpan metadata, uint8_t key, T& value);
+
+// Appends an entry to a block, e.g. Path::metadata; false if it would not fit in 255 bytes
+bool appendMetadata(std::pmr::vector<uint8_t>& metadata, uint8_t key, const void* value, size_t size);
+
+template <class T> bool appendMetadata(std::pmr::vector<uint8_t>& metadata, uint8_t key, const T& value) {
+    return appendMetadata(metadata, key, &value, sizeof(T));
+}
+
+// Copies the file metadata of a view into PathFile::metadata, without the waypoint encoding entry. A block that is
+// not a list of entries is copied as it is.
+void copyFileMetadata(ByteSpan fileMetadata, std::pmr::vector<uint8_t>& output);
+
+inline ByteSpan metadataSpan(const std::pmr::vector<uint8_t>& metadata) { return {metadata.data(), metadata.size()}; }
+
+template <class T> bool findMetadata(ByteSpan metadata, uint8_t key, T& value) {
+    ByteSpan found;
+    if (!findMetadata(metadata, key, found) || found.size != sizeof(T)) return false;
+    memcpy(&value, found.data, sizeof(T));
+    return true;
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
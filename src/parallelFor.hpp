@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace lemlib {
+namespace PathFileSystem {
+
+inline unsigned resolveThreadCount(unsigned threads) {
+    if (threads != 0) return threads;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs fn(i) for every i in [0, count) on a work-stealing pool of the given number of threads, the calling
+// thread included. Every worker owns a contiguous range and takes indices from its front; a worker that runs
+// dry steals the back half of the largest remaining range.
+template <class F> void parallelFor(size_t count, unsigned threads, F&& fn) {
+    threads = (unsigned)std::min<size_t>(resolveThreadCount(threads), std::max<size_t>(count, 1));
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+
+    // a range is packed as begin << 32 | end so it can be updated with a single compare-and-swap
+    auto pack = [](uint64_t begin, uint64_t end) { return begin << 32 | end; };
+    std::unique_ptr<std::atomic<uint64_t>[]> ranges(new std::atomic<uint64_t>[threads]);
+    for (unsigned t = 0; t < threads; t++) ranges[t] = pack(count * t / threads, count * (t + 1) / threads);
+
+    auto worker = [&](unsigned self) {
+        for (;;) {
+            uint64_t range = ranges[self].load();
+            uint32_t begin = range >> 32, end = (uint32_t)range;
+            if (begin < end) {
+                if (ranges[self].compare_exchange_weak(range, pack(begin + 1, end))) fn(begin);
+                continue;
+            }
+
+            // find the victim with the most work left
+            unsigned victim = self;
+            uint32_t most = 0;
+            for (unsigned t = 0; t < threads; t++) {
+                uint64_t r = ranges[t].load();
+                uint32_t left = (uint32_t)r > (r >> 32) ? (uint32_t)r - (uint32_t)(r >> 32) : 0;
+                if (left > most) most = left, victim = t;
+            }
+            if (most == 0) return;
+
+            uint64_t stolen = ranges[victim].load();
+            uint32_t vBegin = stolen >> 32, vEnd = (uint32_t)stolen;
+            if (vBegin >= vEnd) continue;
+            uint32_t split = vEnd - (vEnd - vBegin + 1) / 2;
+            if (!ranges[victim].compare_exchange_strong(stolen, pack(vBegin, split))) continue;
+
+            // our own range is empty, so nobody else can be updating it
+            ranges[self] = pack(split, vEnd);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; t++) pool.emplace_back(worker, t);
+    worker(0);
+    for (std::thread& t : pool) t.join();
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "pathFileSystem.hpp"
+#include "pathFileView.hpp"
+#include "waypointKernels.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+struct NoColumn {};
+
+template <unsigned Fields, unsigned Field, class T>
+using FieldColumn = std::conditional_t<(Fields & Field) != 0, std::vector<T>, NoColumn>;
+
+// A path with a column for each field in Fields and nothing for the others, e.g. PathColumns<WaypointX | WaypointY>
+// to draw a preview. Decoding skips the other fields through the record layout, and absent heading or lookahead
+// values read as 0.
+template <unsigned Fields> class PathColumns {
+        static_assert(Fields != 0 && (Fields & ~0x1Fu) == 0, "Fields must be a non-empty mask of WaypointField");
+    public:
+        static constexpr unsigned fields = Fields;
+
+        std::string name;
+        FieldColumn<Fields, WaypointX, int16_t> x;
+        FieldColumn<Fields, WaypointY, int16_t> y;
+        FieldColumn<Fields, WaypointSpeed, int16_t> speed;
+        FieldColumn<Fields, WaypointHeading, uint16_t> heading;
+        FieldColumn<Fields, WaypointLookahead, int16_t> lookahead;
+
+        size_t size() const { return count; }
+
+        void resize(size_t n);
+    private:
+        size_t count = 0;
+};
+
+// Decodes only the fields of the columns through WaypointCursor::read<Fields>(), reusing their storage. The mask stays
+// a template argument down to the kernels: in the plain layout runs of records of the same flag go through the
+// vector kernels compiled for Fields; the delta layout decodes every field, since later records depend on them, and
+// keeps the requested ones.
+template <unsigned Fields> bool decode(const PathView& view, PathColumns<Fields>& output);
+// appends the paths of the file to output
+template <unsigned Fields>
+bool decode(const uint8_t* fileBuffer, const size_t fileSize, std::vector<PathColumns<Fields>>& output);
+
+template <unsigned Fields> void PathColumns<Fields>::resize(size_t n) {
+    if constexpr ((Fields & WaypointX) != 0) x.resize(n);
+    if constexpr ((Fields & WaypointY) != 0) y.resize(n);
+    if constexpr ((Fields & WaypointSpeed) != 0) speed.resize(n);
+    if constexpr ((Fields & WaypointHeading) != 0) heading.resize(n);
+    if constexpr ((Fields & WaypointLookahead) != 0) lookahead.resize(n);
+    count = n;
+}
+
+template <unsigned Fields> bool decode(const PathView& view, PathColumns<Fields>& output) {
+    output.name = view.name();
+    WaypointCursor waypoints = view.waypoints();
+    // never trust the count further than the bytes that are actually there
+    output.resize(std::min<size_t>(view.waypointCount(), waypoints.recordsThatFit()));
+    if (output.size() != view.waypointCount()) return false;
+
+    // the columns that are not wanted stay nullptr, and read<Fields>() is compiled without them
+    WaypointColumns columns = {};
+    if constexpr ((Fields & WaypointX) != 0) columns.x = output.x.data();
+    if constexpr ((Fields & WaypointY) != 0) columns.y = output.y.data();
+    if constexpr ((Fields & WaypointSpeed) != 0) columns.speed = output.speed.data();
+    if constexpr ((Fields & WaypointHeading) != 0) columns.heading = output.heading.data();
+    if constexpr ((Fields & WaypointLookahead) != 0) columns.lookahead = output.lookahead.data();
+
+    return waypoints.read<Fields>(columns, output.size()) == output.size() && !waypoints.failed();
+}
+
+template <unsigned Fields>
+bool decode(const uint8_t* fileBuffer, const size_t fileSize, std::vector<PathColumns<Fields>>& output) {
+    try {
+        PathFileView view(fileBuffer, fileSize);
+        if (!view.valid() || !view.verify()) return false;
+
+        PathCursor paths = view.paths();
+        PathView p;
+        while (paths.next(p)) {
+            output.emplace_back();
+            if (!decode(p, output.back())) return false;
+        }
+
+        return !paths.failed();
+    } catch (std::exception& e) { return false; }
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "pathFileSystem.hpp"
+#include "pathFileFormat.hpp"
+#include "deltaCodec.hpp"
+#include "crc32c.hpp"
+#include "metadata.hpp"
+#include "unknownParameters.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// The writers of the file header and of path records, shared by the encoders of PathFile and PathSoAFile. A path
+// type P needs name, metadata and unknownParameters members like Path, and overloads of waypointCount(p) and
+// waypointAt(p, i) found by argument dependent lookup; a file type F needs metadata and paths members like PathFile.
+
+inline size_t waypointCount(const Path& p) { return p.waypoints.size(); }
+
+inline const Waypoint& waypointAt(const Path& p, size_t i) { return p.waypoints[i]; }
+
+inline bool isDelta(const EncodeOptions& options) { return options.waypoints == WaypointEncoding::Delta; }
+
+template <class P> bool isEncodablePath(const P& p) {
+    if (!format::isEncodableName(p.name)) return false;
+    if (p.metadata.size() > UINT8_MAX || waypointCount(p) > UINT32_MAX) return false;
+    return isValidUnknownParameters(p.unknownParameters.data(), p.unknownParameters.size(), waypointCount(p));
+}
+
+template <class P> size_t waypointBytes(const P& p, const EncodeOptions& options) {
+    size_t size = 0;
+    for (const UnknownParameters& u : p.unknownParameters) size += unknownParametersSize(u, options.waypoints);
+    if (isDelta(options)) {
+        DeltaState state;
+        for (size_t i = 0; i < waypointCount(p); i++) size += encodedDeltaSize(waypointAt(p, i), state);
+        return size;
+    }
+    for (size_t i = 0; i < waypointCount(p); i++) {
+        const auto& w = waypointAt(p, i);
+        const uint8_t flag = (w.isHeadingAvailable ? format::headingFlag : 0) |
+                             (w.isLookaheadAvailable ? format::lookaheadFlag : 0);
+        size += format::recordSize(flag);
+    }
+    return size;
+}
+
+template <class P> size_t encodedPathSize(const P& p, const EncodeOptions& options) {
+    // the delta layout adds the byte size of the records so readers can skip them without decoding
+    size_t size = p.name.size() + 1 + 1 + p.metadata.size() + sizeof(uint32_t);
+    if (isDelta(options)) size += sizeof(uint32_t);
+    return size + waypointBytes(p, options);
+}
+
+// writes exactly encodedPathSize(p, options) bytes of a path isEncodablePath() accepted
+template <class P> uint8_t* encodePath(const P& p, uint8_t* dst, const EncodeOptions& options) {
+    memcpy(dst, p.name.data(), p.name.size());
+    dst += p.name.size();
+    *dst++ = 0;
+    *dst++ = p.metadata.size();
+    if (!p.metadata.empty()) memcpy(dst, p.metadata.data(), p.metadata.size());
+    dst += p.metadata.size();
+    dst = format::store<uint32_t>(dst, waypointCount(p));
+
+    UnknownParametersCursor unknown(p.unknownParameters.data(), p.unknownParameters.size());
+    if (isDelta(options)) {
+        uint8_t* blockSize = dst;
+        dst += sizeof(uint32_t);
+        DeltaState state;
+        for (size_t i = 0; i < waypointCount(p); i++) {
+            uint8_t* record = dst;
+            dst = encodeDelta(dst, waypointAt(p, i), state);
+            if (const UnknownParameters* u = unknown.at(i))
+                dst = storeUnknownParameters(record, dst, *u, options.waypoints);
+        }
+        format::store<uint32_t>(blockSize, dst - blockSize - sizeof(uint32_t));
+        return dst;
+    }
+
+    for (size_t i = 0; i < waypointCount(p); i++) {
+        const auto& w = waypointAt(p, i);
+        uint8_t* record = dst;
+        *dst++ = (w.isHeadingAvailable ? format::headingFlag : 0) |
+                 (w.isLookaheadAvailable ? format::lookaheadFlag : 0);
+        dst = format::store(dst, w.x);
+        dst = format::store(dst, w.y);
+        dst = format::store(dst, w.speed);
+        if (w.isHeadingAvailable) dst = format::store(dst, w.heading);
+        if (w.isLookaheadAvailable) dst = format::store(dst, w.lookahead);
+        if (const UnknownParameters* u = unknown.at(i))
+            dst = storeUnknownParameters(record, dst, *u, options.waypoints);
+    }
+
+    return dst;
+}
+
+// the encoding entry of the delta layout, then the metadata of the file; the plain layout has no entry of its own,
+// as files had none before the delta layout existed
+template <class F> size_t fileMetadataSize(const F& input, const EncodeOptions& options) {
+    return (isDelta(options) ? 3 : 0) + input.metadata.size();
+}
+
+template <class F> size_t headerSize(const F& input, const EncodeOptions& options) {
+    return (options.header ? format::fileHeaderSize : 0) + 1 + fileMetadataSize(input, options) + sizeof(uint16_t);
+}
+
+// the size and checksum of the body are filled in by sealHeader() once it is written
+template <class F> uint8_t* encodeHeader(const F& input, uint8_t* dst, const EncodeOptions& options) {
+    if (options.header) {
+        memcpy(dst, format::magic, sizeof(format::magic));
+        memset(dst + sizeof(format::magic), 0, format::fileHeaderSize - sizeof(format::magic));
+        dst[format::versionOffset] = format::version;
+        dst += format::fileHeaderSize;
+    }
+    *dst++ = fileMetadataSize(input, options);
+    if (isDelta(options)) {
+        *dst++ = format::waypointEncodingTag;
+        *dst++ = 1;
+        *dst++ = (uint8_t)WaypointEncoding::Delta;
+    }
+    if (!input.metadata.empty()) memcpy(dst, input.metadata.data(), input.metadata.size());
+    dst += input.metadata.size();
+    return format::store<uint16_t>(dst, input.paths.size());
+}
+
+inline uint8_t* encodeEditorData(uint8_t* dst, const EncodeOptions& options) {
+    if (options.editorData.size > 0) memcpy(dst, options.editorData.data, options.editorData.size);
+    return dst + options.editorData.size;
+}
+
+// the body size field of the header has 32 bits
+inline bool fitsHeader(size_t fileSize, const EncodeOptions& options) {
+    return !options.header || fileSize - format::fileHeaderSize <= UINT32_MAX;
+}
+
+inline void sealHeader(uint8_t* file, size_t fileSize, uint32_t bodyChecksum) {
+    format::store<uint32_t>(file + format::bodySizeOffset, fileSize - format::fileHeaderSize);
+    format::store<uint32_t>(file + format::checksumOffset, bodyChecksum);
+}
+
+inline void sealHeader(uint8_t* file, size_t fileSize) {
+    sealHeader(file, fileSize, crc32c(file + format::fileHeaderSize, fileSize - format::fileHeaderSize));
+}
+
+template <class F> bool isEncodableFile(const F& input, const EncodeOptions& options) {
+    if (input.paths.size() > UINT16_MAX || fileMetadataSize(input, options) > UINT8_MAX) return false;
+    // the encoding entry is written by the encoder alone
+    ByteSpan encoding;
+    if (findMetadata({input.metadata.data(), input.metadata.size()}, format::waypointEncodingTag, encoding))
+        return false;
+    for (const auto& p : input.paths) {
+        if (!isEncodablePath(p)) return false;
+    }
+    return true;
+}
+
+template <class F> size_t encodedFileSize(const F& input, const EncodeOptions& options) {
+    size_t size = headerSize(input, options) + options.editorData.size;
+    for (const auto& p : input.paths) size += encodedPathSize(p, options);
+    return size;
+}
+
+// fileSize is the capacity of fileBuffer on input and the encoded size on output
+template <class F>
+bool encodeFile(const F& input, uint8_t* fileBuffer, size_t& fileSize, const EncodeOptions& options) {
+    if (!isEncodableFile(input, options)) return false;
+    const size_t size = encodedFileSize(input, options);
+    if (size > fileSize || !fitsHeader(size, options)) return false;
+
+    uint8_t* dst = encodeHeader(input, fileBuffer, options);
+    for (const auto& p : input.paths) dst = encodePath(p, dst, options);
+    dst = encodeEditorData(dst, options);
+
+    fileSize = dst - fileBuffer;
+    if (options.header) sealHeader(fileBuffer, fileSize);
+    return true;
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
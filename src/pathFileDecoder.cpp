@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cstring>
+#include "pathFileDecoder.hpp"
+#include "pathFileFormat.hpp"
+#include "pathFileView.hpp"
+#include "crc32c.hpp"
+#include "unknownParameters.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+static const uint8_t* decodeRecord(const uint8_t* record, Waypoint& w) {
+    const format::RecordLayout& layout = format::recordLayout(record[0]);
+    w.x = format::load<int16_t>(record + 1);
+    w.y = format::load<int16_t>(record + 3);
+    w.speed = format::load<int16_t>(record + 5);
+    if ((w.isHeadingAvailable = layout.heading != 0)) w.heading = format::load<uint16_t>(record + layout.heading);
+    if ((w.isLookaheadAvailable = layout.lookahead != 0))
+        w.lookahead = format::load<int16_t>(record + layout.lookahead);
+    return record + layout.size;
+}
+
+PathFileDecoder::PathFileDecoder(PathCallback onPath, const Path::allocator_type& alloc)
+    : onPath(std::move(onPath)), alloc(alloc), current(alloc) {}
+
+void PathFileDecoder::reset() {
+    framing = Framing::Detect;
+    headerSize = 0;
+    bodyLeft = 0;
+    checksum = 0;
+    state = State::FileMetadataSize;
+    fileHeaderSize = 0;
+    encoding = WaypointEncoding::Plain;
+    pendingSize = 0;
+    skipSize = 0;
+    pathsLeft = 0;
+    waypointsLeft = 0;
+    decodedPaths = 0;
+    current = Path(alloc);
+}
+
+PathFileDecoder::Status PathFileDecoder::status() const {
+    if (state == State::Done) return framing == Framing::Header && bodyLeft > 0 ? Status::NeedMoreData : Status::Done;
+    if (state == State::Error) return Status::Error;
+    return Status::NeedMoreData;
+}
+
+// collects size bytes into pending, true once they are all there
+bool PathFileDecoder::take(const uint8_t*& ptr, const uint8_t* end, size_t size) {
+    size_t n = std::min<size_t>(size - pendingSize, end - ptr);
+    memcpy(pending + pendingSize, ptr, n);
+    pendingSize += n;
+    ptr += n;
+    if (pendingSize < size) return false;
+    pendingSize = 0;
+    return true;
+}
+
+void PathFileDecoder::finishPath() {
+    onPath(std::move(current));
+    current = Path(alloc);
+    decodedPaths++;
+    state = --pathsLeft == 0 ? State::Done : State::Name;
+
+    // like the cursors, continue after the end of the record block even if the records did not fill it
+    if (state == State::Name && encoding != WaypointEncoding::Plain && blockLeft > 0) {
+        skipSize = blockLeft;
+        state = State::BlockTail;
+    }
+}
+
+void PathFileDecoder::addWaypoint(const uint8_t* record, const Waypoint& w) {
+    if (*record & format::unknownFlags)
+        current.unknownParameters.push_back(loadUnknownParameters(record, encoding, current.waypoints.size()));
+    current.waypoints.push_back(w);
+}
+
+bool PathFileDecoder::addDelta(const uint8_t* record, size_t size) {
+    Waypoint w;
+    if (size > blockLeft || decodeDelta(record, record + size, deltaState, w) == nullptr) {
+        state = State::Error;
+        return false;
+    }
+    addWaypoint(record, w);
+    blockLeft -= size;
+    if (--waypointsLeft == 0) finishPath();
+    return true;
+}
+
+void PathFileDecoder::feedDelta(const uint8_t*& ptr, const uint8_t* end) {
+    if (pendingSize == 0) {
+        // whole records in this chunk are decoded straight from it
+        const uint8_t* limit = ptr + std::min<size_t>(end - ptr, blockLeft);
+        Waypoint w;
+        while (waypointsLeft > 0) {
+            const DeltaState saved = deltaState;
+            const uint8_t* next = decodeDelta(ptr, limit, deltaState, w);
+            if (next == nullptr) {
+                deltaState = saved;
+                break;
+            }
+            addWaypoint(ptr, w);
+            blockLeft -= next - ptr;
+            ptr = next;
+            waypointsLeft--;
+        }
+        if (waypointsLeft == 0) {
+            finishPath();
+            return;
+        }
+        // a record that is complete but does not decode is malformed
+        if (deltaRecordSize(ptr, limit) != 0 || limit != end) {
+            state = State::Error;
+            return;
+        }
+    }
+
+    // a record split across chunks is collected a byte at a time until it is complete
+    while (pendingSize == 0 || deltaRecordSize(pending, pending + pendingSize) == 0) {
+        if (ptr == end) return;
+        pending[pendingSize++] = *ptr++;
+    }
+    const size_t size = pendingSize;
+    pendingSize = 0;
+    addDelta(pending, size);
+}
+
+PathFileDecoder::Status PathFileDecoder::feed(const uint8_t* data, size_t size) {
+    try {
+        const uint8_t* ptr = data;
+        const uint8_t* end = data + size;
+        if (framing == Framing::Detect) feedHeader(ptr, end);
+        if (framing != Framing::Detect) feedBody(ptr, end);
+    } catch (std::exception& e) { state = State::Error; }
+
+    return status();
+}
+
+void PathFileDecoder::feedHeader(const uint8_t*& ptr, const uint8_t* end) {
+    while (ptr < end) {
+        header[headerSize++] = *ptr++;
+        if (headerSize <= sizeof(format::magic) && header[headerSize - 1] != format::magic[headerSize - 1]) {
+            // a file without header, the bytes taken so far are its first ones
+            framing = Framing::Headerless;
+            feedChunk(header, header + headerSize);
+            return;
+        }
+        if (headerSize == format::fileHeaderSize) {
+            bodyLeft = format::load<uint32_t>(header + format::bodySizeOffset);
+            if (header[format::versionOffset] != format::version || bodyLeft == 0) state = State::Error;
+            framing = Framing::Header;
+            return;
+        }
+    }
+}
+
+void PathFileDecoder::feedBody(const uint8_t* ptr, const uint8_t* end) {
+    if (framing == Framing::Headerless) return feedChunk(ptr, end);
+    if (state == State::Error || bodyLeft == 0) return;
+
+    // bytes after the body are not part of the file
+    const size_t n = std::min<size_t>(bodyLeft, end - ptr);
+    checksum = crc32c(ptr, n, checksum);
+    bodyLeft -= n;
+    feedChunk(ptr, ptr + n);
+
+    if (bodyLeft == 0 && (state != State::Done || checksum != format::load<uint32_t>(header + format::checksumOffset)))
+        state = State::Error;
+}
+
+void PathFileDecoder::feedChunk(const uint8_t* ptr, const uint8_t* end) {
+    while (ptr < end) {
+        switch (state) {
+            case State::FileMetadataSize:
+                skipSize = fileHeader[fileHeaderSize++] = *ptr++;
+                state = skipSize == 0 ? State::PathCount : State::FileMetadata;
+                break;
+            case State::PathMetadataSize:
+                skipSize = *ptr++;
+                state = skipSize == 0 ? State::WaypointCount : State::PathMetadata;
+                break;
+            case State::FileMetadata: {
+                size_t n = std::min<size_t>(skipSize, end - ptr);
+                memcpy(fileHeader + fileHeaderSize, ptr, n);
+                fileHeaderSize += n;
+                ptr += n;
+                skipSize -= n;
+                if (skipSize == 0) state = State::PathCount;
+                break;
+            }
+            case State::PathMetadata: {
+                size_t n = std::min<size_t>(skipSize, end - ptr);
+                current.metadata.insert(current.metadata.end(), ptr, ptr + n);
+                ptr += n;
+                skipSize -= n;
+                if (skipSize == 0) state = State::WaypointCount;
+                break;
+            }
+            case State::BlockTail: {
+                size_t n = std::min<size_t>(skipSize, end - ptr);
+                ptr += n;
+                skipSize -= n;
+                if (skipSize == 0) state = State::Name;
+                break;
+            }
+            case State::PathCount: {
+                if (!take(ptr, end, sizeof(uint16_t))) break;
+                memcpy(fileHeader + fileHeaderSize, pending, sizeof(uint16_t));
+                PathFileView view(fileHeader, fileHeaderSize + sizeof(uint16_t));
+                if (!view.valid()) {
+                    state = State::Error;
+                    return;
+                }
+                encoding = view.encoding();
+                pathsLeft = view.pathCount();
+                state = pathsLeft == 0 ? State::Done : State::Name;
+                break;
+            }
+            case State::Name: {
+                // same rule as decode(): stop at a null byte or after maxNameLength characters
+                size_t limit = std::min<size_t>(end - ptr, format::maxNameLength - current.name.size());
+                const uint8_t* nul = static_cast<const uint8_t*>(memchr(ptr, 0x00, limit));
+                const uint8_t* stop = nul != nullptr ? nul : ptr + limit;
+                current.name.append(reinterpret_cast<const char*>(ptr), stop - ptr);
+                ptr = nul != nullptr ? nul + 1 : stop;
+                if (nul != nullptr || current.name.size() == format::maxNameLength) state = State::PathMetadataSize;
+                break;
+            }
+            case State::WaypointCount:
+                if (!take(ptr, end, sizeof(uint32_t))) break;
+                waypointsLeft = format::load<uint32_t>(pending);
+                // the count is not trusted for more than a modest reservation
+                current.waypoints.reserve(std::min<uint32_t>(waypointsLeft, 4096));
+                if (encoding != WaypointEncoding::Plain) {
+                    state = State::WaypointBytes;
+                    break;
+                }
+                state = State::Waypoint;
+                if (waypointsLeft == 0) finishPath();
+                break;
+            case State::WaypointBytes:
+                if (!take(ptr, end, sizeof(uint32_t))) break;
+                blockLeft = format::load<uint32_t>(pending);
+                deltaState = DeltaState();
+                state = State::Waypoint;
+                if (waypointsLeft == 0) finishPath();
+                break;
+            case State::Waypoint: {
+                if (encoding != WaypointEncoding::Plain) {
+                    feedDelta(ptr, end);
+                    break;
+                }
+                Waypoint w;
+                if (pendingSize == 0) {
+                    // whole records in this chunk are decoded straight from it
+                    while (waypointsLeft > 0 && ptr != end && (size_t)(end - ptr) >= format::recordSize(*ptr)) {
+                        const uint8_t* record = ptr;
+                        ptr = decodeRecord(ptr, w);
+                        addWaypoint(record, w);
+                        waypointsLeft--;
+                    }
+                    if (waypointsLeft == 0) {
+                        finishPath();
+                        break;
+                    }
+                    if (ptr == end) break;
+                }
+
+                if (!take(ptr, end, format::recordSize(pendingSize > 0 ? pending[0] : *ptr))) break;
+                decodeRecord(pending, w);
+                addWaypoint(pending, w);
+                if (--waypointsLeft == 0) finishPath();
+                break;
+            }
+            case State::Done:
+            case State::Error: return;
+        }
+    }
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
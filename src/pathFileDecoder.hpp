@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include "pathFileSystem.hpp"
+#include "pathFileFormat.hpp"
+#include "deltaCodec.hpp"
+#include "pathFileView.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// Incremental decoder for input that arrives in chunks. Chunks may end anywhere, even in the middle of a
+// field; only the path being decoded and a few bytes of the split field are kept between calls. For files with a
+// header, the checksum is computed as the body arrives and Done is only reported once the whole body is there and
+// matches; paths already handed to the callback should be discarded on Error.
+class PathFileDecoder {
+    public:
+        enum class Status { NeedMoreData, Done, Error };
+
+        // called with each path as soon as its last waypoint has arrived
+        using PathCallback = std::function<void(Path&& path)>;
+    private:
+        enum class Framing { Detect, Headerless, Header };
+
+        enum class State {
+            FileMetadataSize,
+            FileMetadata,
+            PathCount,
+            Name,
+            PathMetadataSize,
+            PathMetadata,
+            WaypointCount,
+            WaypointBytes,
+            Waypoint,
+            BlockTail,
+            Done,
+            Error
+        };
+
+        PathCallback onPath;
+        Path::allocator_type alloc;
+        Framing framing = Framing::Detect;
+        uint8_t header[format::fileHeaderSize];
+        size_t headerSize = 0;
+        uint32_t bodyLeft = 0;
+        uint32_t checksum = 0;
+        State state = State::FileMetadataSize;
+        uint8_t fileHeader[1 + UINT8_MAX + sizeof(uint16_t)]; // collected whole to read the waypoint encoding
+        size_t fileHeaderSize = 0;
+        WaypointEncoding encoding = WaypointEncoding::Plain;
+        uint8_t pending[format::maxDeltaRecordSize]; // a field or waypoint record split across chunks
+        size_t pendingSize = 0;
+        size_t skipSize = 0;
+        uint16_t pathsLeft = 0;
+        uint32_t waypointsLeft = 0;
+        uint32_t blockLeft = 0; // bytes left in the record block of a delta path
+        DeltaState deltaState;
+        uint16_t decodedPaths = 0;
+        Path current;
+
+        bool take(const uint8_t*& ptr, const uint8_t* end, size_t size);
+        void feedHeader(const uint8_t*& ptr, const uint8_t* end);
+        void feedBody(const uint8_t* ptr, const uint8_t* end);
+        void feedChunk(const uint8_t* ptr, const uint8_t* end);
+        void feedDelta(const uint8_t*& ptr, const uint8_t* end);
+        void addWaypoint(const uint8_t* record, const Waypoint& w);
+        bool addDelta(const uint8_t* record, size_t size);
+        void finishPath();
+    public:
+        // paths are allocated with alloc
+        PathFileDecoder(PathCallback onPath, const Path::allocator_type& alloc = {});
+
+        // bytes after the last path (editor data) and after the body are accepted and ignored
+        Status feed(const uint8_t* data, size_t size);
+
+        Status status() const;
+
+        uint16_t pathCount() const { return decodedPaths; }
+
+        // the file metadata as PathFileView::metadata() reads it, complete once the first path has started
+        ByteSpan metadata() const { return {fileHeader + 1, fileHeaderSize > 0 ? fileHeader[0] : (size_t)0}; }
+
+        void reset();
+};
+
+} // namespace PathFileSystem
+} // namespace lemlib
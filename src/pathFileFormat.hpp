@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <string_view>
+
+namespace lemlib {
+namespace PathFileSystem {
+namespace format {
+
+// All integers are stored little-endian; like the rest of the library we assume a little-endian host
+template <class T> inline T load(const uint8_t* src) {
+    T value;
+    memcpy(&value, src, sizeof(T));
+    return value;
+}
+
+template <class T> inline uint8_t* store(uint8_t* dst, T value) {
+    memcpy(dst, &value, sizeof(T));
+    return dst + sizeof(T);
+}
+
+// Files written with a header start with these 16 bytes: the magic, the format version, three reserved bytes, the
+// size of the body that follows and its CRC32C. Older files start directly with the metadata size.
+constexpr uint8_t magic[4] = {0x89, 'L', 'P', 'F'};
+constexpr uint8_t version = 1;
+constexpr size_t fileHeaderSize = 16;
+constexpr size_t versionOffset = 4;
+constexpr size_t bodySizeOffset = 8;
+constexpr size_t checksumOffset = 12;
+
+constexpr size_t maxNameLength = 1024;
+
+// decode() reads a name up to its null byte or maxNameLength characters, so only shorter names without one come
+// back unchanged
+inline bool isEncodableName(std::string_view name) {
+    return name.size() < maxNameLength && name.find('\0') == std::string_view::npos;
+}
+
+// flag + x + y + speed
+constexpr size_t waypointHeaderSize = 7;
+
+constexpr uint8_t headingFlag = 0x01;
+constexpr uint8_t lookaheadFlag = 0x02;
+// parameters this version does not interpret, kept in Path::unknownParameters
+constexpr uint8_t unknownFlags = 0xFC;
+
+// Where the fields of a plain record are, for each value of its flag byte: every set bit adds one 16-bit parameter
+// after the speed, in bit order. Offsets are from the flag byte, 0 for a field the record does not have. Decoding,
+// sizing and skipping a record take one lookup instead of a test per flag bit.
+struct RecordLayout {
+        uint8_t size = 0;
+        uint8_t fields = 0; // x, y, speed and the parameters
+        uint8_t heading = 0;
+        uint8_t lookahead = 0;
+        uint8_t unknown[6] = {}; // the parameters of bits 0x04 to 0x80
+};
+
+struct RecordLayouts {
+        RecordLayout layout[256];
+};
+
+constexpr RecordLayouts makeRecordLayouts() {
+    RecordLayouts t;
+    for (unsigned flag = 0; flag < 256; flag++) {
+        RecordLayout& l = t.layout[flag];
+        uint8_t offset = waypointHeaderSize;
+        l.fields = 3;
+        for (unsigned bit = 0; bit < 8; bit++) {
+            if ((flag & (1u << bit)) == 0) continue;
+            if (bit == 0) l.heading = offset;
+            else if (bit == 1) l.lookahead = offset;
+            else l.unknown[bit - 2] = offset;
+            offset += 2;
+            l.fields++;
+        }
+        l.size = offset;
+    }
+    return t;
+}
+
+inline constexpr RecordLayouts recordLayouts = makeRecordLayouts();
+
+constexpr const RecordLayout& recordLayout(uint8_t flag) { return recordLayouts.layout[flag]; }
+
+constexpr size_t recordSize(uint8_t flag) { return recordLayout(flag).size; }
+
+// the number of parameters after the speed, one per set flag bit
+constexpr size_t parameterCount(uint8_t flag) { return recordLayout(flag).fields - 3; }
+
+// field count of a record: x, y and speed, then one parameter per set flag bit
+constexpr size_t fieldCount(uint8_t flag) { return recordLayout(flag).fields; }
+
+constexpr size_t maxRecordSize = recordSize(0xFF);
+
+// Skips up to n plain records, returns the number skipped. Stops at a record that runs past end, which is only
+// checked for once the records left could reach it.
+inline size_t skipWaypoints(const uint8_t*& ptr, const uint8_t* end, size_t n) {
+    const uint8_t* p = ptr;
+    size_t done = 0;
+    for (size_t safe; (safe = std::min(n - done, (size_t)(end - p) / maxRecordSize)) > 0; done += safe) {
+        for (size_t i = 0; i < safe; i++) p += recordLayout(*p).size;
+    }
+    for (; done < n && p != end; done++) {
+        const size_t size = recordLayout(*p).size;
+        if ((size_t)(end - p) < size) break;
+        p += size;
+    }
+    ptr = p;
+    return done;
+}
+
+// Top-level metadata is a list of (tag, length, value) entries. This one selects the waypoint record layout;
+// files without it use the plain layout.
+constexpr uint8_t waypointEncodingTag = 0x01;
+
+// In the delta layout every field is a zigzag encoded LEB128 varint of at most 3 bytes
+constexpr size_t maxVarintSize = 3;
+constexpr size_t maxDeltaRecordSize = 1 + maxVarintSize * fieldCount(0xFF);
+constexpr size_t minDeltaRecordSize = 1 + fieldCount(0);
+
+constexpr uint16_t zigzag(int16_t value) { return (uint16_t)(((uint16_t)value << 1) ^ (uint16_t)(value >> 15)); }
+
+constexpr int16_t unzigzag(uint16_t value) { return (int16_t)((value >> 1) ^ (uint16_t)-(value & 1)); }
+
+constexpr size_t varintSize(uint16_t value) { return value < 0x80 ? 1 : value < 0x4000 ? 2 : 3; }
+
+inline uint8_t* storeVarint(uint8_t* dst, uint16_t value) {
+    while (value >= 0x80) {
+        *dst++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *dst++ = (uint8_t)value;
+    return dst;
+}
+
+// nullptr if the varint runs past end or does not fit in 16 bits
+inline const uint8_t* loadVarint(const uint8_t* src, const uint8_t* end, uint16_t& value) {
+    if (src == end) return nullptr;
+    uint32_t b = *src++;
+    if (b < 0x80) return value = b, src;
+    uint32_t v = b & 0x7F;
+    if (src == end) return nullptr;
+    b = *src++;
+    if (b < 0x80) return value = v | b << 7, src;
+    v |= (b & 0x7F) << 7;
+    if (src == end || *src > 0x03) return nullptr;
+    value = v | *src++ << 14;
+    return src;
+}
+
+} // namespace format
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,81 @@
+#include "pathFileIndex.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+bool scan(const uint8_t* fileBuffer, const size_t fileSize, std::vector<PathIndexEntry>& index, bool verify) {
+    PathFileView view(fileBuffer, fileSize);
+    if (!view.valid() || (verify && !view.verify())) return false;
+
+    index.reserve(index.size() + view.pathCount());
+
+    const uint8_t* end = view.body().data + view.body().size;
+    const uint8_t* ptr = view.firstPath();
+    for (uint16_t i = 0; i < view.pathCount(); i++) {
+        PathView p;
+        if (!PathView::parse(ptr, end, view.encoding(), p)) return false;
+
+        WaypointCursor waypoints = p.waypoints();
+        const uint8_t* body = waypoints.position();
+        waypoints.skip(waypoints.remaining());
+        if (waypoints.failed()) return false;
+
+        index.push_back({(size_t)(ptr - fileBuffer), (size_t)(body - fileBuffer),
+                         (size_t)(waypoints.position() - ptr), p.waypointCount(), p.name()});
+        ptr = waypoints.position();
+    }
+
+    return true;
+}
+
+bool LazyPathFile::open(const uint8_t* fileBuffer, const size_t fileSize, bool verify) {
+    buffer = fileBuffer;
+    bufferSize = fileSize;
+    index.clear();
+    cache.clear();
+    editor = {};
+
+    if (!scan(fileBuffer, fileSize, index, verify)) {
+        index.clear();
+        return false;
+    }
+
+    cache.resize(index.size());
+    const PathFileView view(fileBuffer, fileSize);
+    encoding = view.encoding();
+    const uint8_t* pathsEnd = index.empty() ? view.firstPath() : buffer + index.back().offset + index.back().size;
+    editor = {pathsEnd, (size_t)(view.body().data + view.body().size - pathsEnd)};
+    return true;
+}
+
+bool LazyPathFile::verify() const { return buffer != nullptr && PathFileView(buffer, bufferSize).verify(); }
+
+long LazyPathFile::find(std::string_view name) const {
+    for (size_t i = 0; i < index.size(); i++)
+        if (index[i].name == name) return (long)i;
+    return -1;
+}
+
+const Path* LazyPathFile::path(size_t idx) {
+    if (idx >= index.size()) return nullptr;
+    if (cache[idx].has_value()) return &*cache[idx];
+
+    PathView view;
+    const uint8_t* begin = buffer + index[idx].offset;
+    if (!PathView::parse(begin, begin + index[idx].size, encoding, view)) return nullptr;
+
+    Path& p = cache[idx].emplace();
+    if (!decode(view, p)) {
+        cache[idx].reset();
+        return nullptr;
+    }
+    return &p;
+}
+
+const Path* LazyPathFile::path(std::string_view name) {
+    long idx = find(name);
+    return idx < 0 ? nullptr : path((size_t)idx);
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "pathFileSystem.hpp"
+#include "pathFileView.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+struct PathIndexEntry {
+        size_t offset; // byte offset of the path name
+        size_t waypointOffset; // byte offset of the first waypoint record
+        size_t size; // bytes from offset to the end of the last waypoint record
+        uint32_t waypointCount;
+        std::string_view name; // points into the scanned buffer
+};
+
+// One pass over the path headers, skipping waypoint records by their flag byte. Appends one entry per path. With
+// verify the checksum of the body is checked first, which reads every byte of the file.
+bool scan(const uint8_t* fileBuffer, const size_t fileSize, std::vector<PathIndexEntry>& index, bool verify = true);
+
+// A path file whose paths are decoded on first access. The buffer must outlive the object.
+class LazyPathFile {
+    private:
+        const uint8_t* buffer = nullptr;
+        size_t bufferSize = 0;
+        std::vector<PathIndexEntry> index;
+        std::vector<std::optional<Path>> cache;
+        WaypointEncoding encoding = WaypointEncoding::Plain;
+        ByteSpan editor;
+    public:
+        LazyPathFile() = default;
+
+        // Without verify only the path headers are read, skipping the records by their flag bytes or block sizes,
+        // and the checksum of the body is left to verify(); a path that fails it may still decode.
+        bool open(const uint8_t* fileBuffer, const size_t fileSize, bool verify = true);
+
+        // checks the checksum of the body, like PathFileView::verify()
+        bool verify() const;
+
+        size_t size() const { return index.size(); }
+
+        const PathIndexEntry& entry(size_t idx) const { return index[idx]; }
+
+        // the bytes after the last path, located by the scan in open()
+        ByteSpan editorData() const { return editor; }
+
+        // returns the index of the first path with this name, or -1
+        long find(std::string_view name) const;
+
+        // nullptr if the index or name does not exist or the path is malformed
+        const Path* path(size_t idx);
+        const Path* path(std::string_view name);
+};
+
+} // namespace PathFileSystem
+} // namespace lemlib
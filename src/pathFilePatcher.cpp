@@ -0,0 +1,199 @@
+#include <cstring>
+#include "pathFilePatcher.hpp"
+#include "pathFileFormat.hpp"
+#include "pathFileIndex.hpp"
+#include "crc32c.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+bool PathFilePatcher::open(std::vector<uint8_t> image) {
+    bytes.clear();
+    index.clear();
+    try {
+        std::vector<PathIndexEntry> scanned;
+        if (!scan(image.data(), image.size(), scanned)) return false;
+
+        PathFileView view(image.data(), image.size());
+        countOffset = view.firstPath() - image.data() - sizeof(uint16_t);
+        encoding = view.encoding();
+        hasHeader = view.hasHeader();
+        pathsEnd = scanned.empty() ? countOffset + sizeof(uint16_t) : scanned.back().offset + scanned.back().size;
+
+        index.reserve(scanned.size());
+        for (const PathIndexEntry& e : scanned)
+            index.push_back({e.offset, e.waypointOffset, e.size, e.name.size(), e.waypointCount, {}});
+        bytes = std::move(image);
+        return true;
+    } catch (std::exception& e) {
+        index.clear();
+        return false;
+    }
+}
+
+std::vector<uint8_t> PathFilePatcher::release() {
+    index.clear();
+    return std::move(bytes);
+}
+
+std::string_view PathFilePatcher::name(size_t path) const {
+    if (path >= index.size()) return {};
+    return std::string_view(reinterpret_cast<const char*>(bytes.data() + index[path].offset), index[path].nameLength);
+}
+
+long PathFilePatcher::find(std::string_view name) const {
+    for (size_t i = 0; i < index.size(); i++)
+        if (this->name(i) == name) return (long)i;
+    return -1;
+}
+
+const std::vector<uint32_t>& PathFilePatcher::records(Entry& entry) {
+    // relative offsets stay correct when the path is moved by edits to other paths
+    if (entry.records.size() != entry.waypointCount) {
+        entry.records.resize(entry.waypointCount);
+        const uint8_t* base = bytes.data() + entry.waypointOffset;
+        uint32_t offset = 0;
+        for (uint32_t& r : entry.records) {
+            r = offset;
+            offset += format::recordSize(base[offset]);
+        }
+    }
+    return entry.records;
+}
+
+bool PathFilePatcher::setWaypoint(size_t path, size_t waypoint, const Waypoint& w) {
+    if (path >= index.size() || waypoint >= index[path].waypointCount) return false;
+    if (encoding != WaypointEncoding::Plain) return false;
+
+    uint8_t* const fields = bytes.data() + index[path].waypointOffset + records(index[path])[waypoint] + 1;
+    const uint8_t flag = fields[-1];
+    if (bool(flag & format::headingFlag) != w.isHeadingAvailable) return false;
+    if (bool(flag & format::lookaheadFlag) != w.isLookaheadAvailable) return false;
+
+    uint8_t diff[10];
+    const size_t size = format::recordSize(flag & (format::headingFlag | format::lookaheadFlag)) - 1;
+    memcpy(diff, fields, size);
+
+    uint8_t* dst = format::store(fields, w.x);
+    dst = format::store(dst, w.y);
+    dst = format::store(dst, w.speed);
+    if (w.isHeadingAvailable) dst = format::store(dst, w.heading);
+    if (w.isLookaheadAvailable) dst = format::store(dst, w.lookahead);
+
+    if (hasHeader) {
+        for (size_t i = 0; i < size; i++) diff[i] ^= fields[i];
+        patchChecksum(fields - bytes.data(), diff, size);
+    }
+    return true;
+}
+
+size_t PathFilePatcher::bodyEnd() const {
+    return format::fileHeaderSize + format::load<uint32_t>(bytes.data() + format::bodySizeOffset);
+}
+
+// updates the checksum in the header after the size bytes at offset were xor-ed with diff
+void PathFilePatcher::patchChecksum(size_t offset, const uint8_t* diff, size_t size) {
+    uint8_t* checksum = bytes.data() + format::checksumOffset;
+    format::store(checksum, crc32cPatch(format::load<uint32_t>(checksum), diff, size, bodyEnd() - offset - size));
+}
+
+void PathFilePatcher::storePathCount() {
+    uint8_t diff[sizeof(uint16_t)];
+    memcpy(diff, bytes.data() + countOffset, sizeof(diff));
+    format::store<uint16_t>(bytes.data() + countOffset, index.size());
+    if (!hasHeader) return;
+    for (size_t i = 0; i < sizeof(diff); i++) diff[i] ^= bytes[countOffset + i];
+    patchChecksum(countOffset, diff, sizeof(diff));
+}
+
+uint32_t PathFilePatcher::checksum(size_t offset, size_t size) const {
+    return hasHeader ? crc32c(bytes.data() + offset, size) : 0;
+}
+
+// grows or shrinks [offset, offset + oldSize) to newSize, moving only the bytes after it, and shifts the entries
+// from firstMoved on
+void PathFilePatcher::resizeRegion(size_t offset, size_t oldSize, size_t newSize, size_t firstMoved) {
+    if (newSize > oldSize) bytes.insert(bytes.begin() + offset + oldSize, newSize - oldSize, 0);
+    else bytes.erase(bytes.begin() + offset + newSize, bytes.begin() + offset + oldSize);
+
+    const ptrdiff_t delta = (ptrdiff_t)newSize - (ptrdiff_t)oldSize;
+    for (size_t i = firstMoved; i < index.size(); i++) {
+        index[i].offset += delta;
+        index[i].waypointOffset += delta;
+    }
+    pathsEnd += delta;
+}
+
+// Updates the size and checksum in the header after the oldSize bytes at offset, with the checksum oldChecksum, were
+// replaced by newSize bytes. Only the new bytes and the bytes moved after them are read.
+void PathFilePatcher::reseal(size_t offset, uint32_t oldChecksum, size_t oldSize, size_t newSize) {
+    if (!hasHeader) return;
+    const size_t bodySize = format::load<uint32_t>(bytes.data() + format::bodySizeOffset) + newSize - oldSize;
+    format::store<uint32_t>(bytes.data() + format::bodySizeOffset, bodySize);
+
+    const size_t moved = bodyEnd() - offset - newSize;
+    const uint32_t movedChecksum = checksum(offset + newSize, moved);
+    const uint32_t oldTail = crc32cCombine(oldChecksum, movedChecksum, moved);
+    const uint32_t newTail = crc32cCombine(checksum(offset, newSize), movedChecksum, moved);
+    uint8_t* crc = bytes.data() + format::checksumOffset;
+    format::store(crc, crc32cReplaceTail(format::load<uint32_t>(crc), oldTail, oldSize + moved, newTail,
+                                         newSize + moved));
+}
+
+bool PathFilePatcher::appendPath(const Path& path) {
+    if (index.size() >= UINT16_MAX) return false;
+    try {
+        EncodeOptions options;
+        options.waypoints = encoding;
+        const size_t size = encodedSize(path, options);
+        const size_t offset = pathsEnd;
+        bytes.insert(bytes.begin() + offset, size, 0);
+        if (encode(path, bytes.data() + offset, options) == nullptr) {
+            bytes.erase(bytes.begin() + offset, bytes.begin() + offset + size);
+            return false;
+        }
+
+        // a path without name, metadata and waypoints is all header
+        const size_t headerSize = path.name.size() + path.metadata.size() + encodedSize(Path(), options);
+        index.push_back({offset, offset + headerSize, size, path.name.size(), (uint32_t)path.waypoints.size(), {}});
+        pathsEnd += size;
+        reseal(offset, 0, 0, size);
+        storePathCount();
+        return true;
+    } catch (std::exception& e) { return false; }
+}
+
+bool PathFilePatcher::rename(size_t path, std::string_view name) {
+    if (path >= index.size() || !format::isEncodableName(name)) return false;
+    try {
+        Entry& entry = index[path];
+        // the name and its null byte, which a name of maxNameLength characters does not have
+        const size_t oldSize = entry.nameLength + (entry.nameLength < format::maxNameLength ? 1 : 0);
+        const size_t newSize = name.size() + 1;
+        const uint32_t oldChecksum = checksum(entry.offset, oldSize);
+        resizeRegion(entry.offset, oldSize, newSize, path + 1);
+        memcpy(bytes.data() + entry.offset, name.data(), name.size());
+        bytes[entry.offset + name.size()] = 0;
+
+        entry.nameLength = name.size();
+        entry.waypointOffset += newSize - oldSize;
+        entry.size += newSize - oldSize;
+        reseal(entry.offset, oldChecksum, oldSize, newSize);
+        return true;
+    } catch (std::exception& e) { return false; }
+}
+
+bool PathFilePatcher::remove(size_t path) {
+    if (path >= index.size()) return false;
+    const size_t offset = index[path].offset;
+    const size_t size = index[path].size;
+    const uint32_t oldChecksum = checksum(offset, size);
+    resizeRegion(offset, size, 0, path + 1);
+    index.erase(index.begin() + path);
+    reseal(offset, oldChecksum, size, 0);
+    storePathCount();
+    return true;
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "pathFileSystem.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// Edits an encoded path file in place using the offsets found by one scan, so an edit costs the size of the change
+// (and, for edits that change a path's length, a move of the bytes after it) instead of a full decode and encode.
+// The header checksum is patched along from the changed bytes, plus the bytes moved after them for edits that
+// change the length; the rest of the body is never read again.
+class PathFilePatcher {
+    private:
+        struct Entry {
+                size_t offset; // byte offset of the path name
+                size_t waypointOffset; // byte offset of the first waypoint record
+                size_t size; // bytes from offset to the end of the last waypoint record
+                size_t nameLength; // a name of maxNameLength characters has no null byte after it
+                uint32_t waypointCount;
+                std::vector<uint32_t> records; // record offsets from waypointOffset, filled on first edit
+        };
+
+        std::vector<uint8_t> bytes;
+        std::vector<Entry> index;
+        size_t countOffset = 0;
+        size_t pathsEnd = 0; // editor data starts here
+        WaypointEncoding encoding = WaypointEncoding::Plain;
+        bool hasHeader = false;
+
+        const std::vector<uint32_t>& records(Entry& entry);
+        void resizeRegion(size_t offset, size_t oldSize, size_t newSize, size_t firstMoved);
+        size_t bodyEnd() const;
+        uint32_t checksum(size_t offset, size_t size) const;
+        void patchChecksum(size_t offset, const uint8_t* diff, size_t size);
+        void storePathCount();
+        void reseal(size_t offset, uint32_t oldChecksum, size_t oldSize, size_t newSize);
+    public:
+        // takes ownership of an encoded file; returns false and stays empty if it is malformed
+        bool open(std::vector<uint8_t> image);
+
+        const std::vector<uint8_t>& image() const { return bytes; }
+
+        // gives the edited file back, leaving the patcher empty
+        std::vector<uint8_t> release();
+
+        size_t size() const { return index.size(); }
+
+        std::string_view name(size_t path) const;
+
+        // returns the index of the first path with this name, or -1
+        long find(std::string_view name) const;
+
+        // Overwrites x, y, speed, heading and lookahead of a record. The record's flag byte is never changed, so w
+        // must have the same heading and lookahead availability as the stored waypoint. Files in the delta layout
+        // cannot be patched this way, since every later record of the path depends on the earlier ones.
+        bool setWaypoint(size_t path, size_t waypoint, const Waypoint& w);
+
+        // inserts after the last path, before any editor data, in the layout of the file
+        bool appendPath(const Path& path);
+
+        bool rename(size_t path, std::string_view name);
+
+        bool remove(size_t path);
+};
+
+} // namespace PathFileSystem
+} // namespace lemlib
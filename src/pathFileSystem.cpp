@@ -1,112 +1,290 @@
 
-#include <iostream>
 #include <algorithm>
-#include <iterator>
 #include <string>
 #include <cstring>
+#include <atomic>
 #include "pathFileSystem.hpp"
+#include "pathFileFormat.hpp"
+#include "pathFileView.hpp"
+#include "pathFileIndex.hpp"
+#include "parallelFor.hpp"
+#include "pathEncoder.hpp"
+#include "crc32c.hpp"
+#include "metadata.hpp"
+#include "unknownParameters.hpp"
 
-class ArrayStreamBuffer : public std::streambuf {
-    private:
-        uint8_t* array;
-        std::size_t size;
-    public:
-        ArrayStreamBuffer(uint8_t* array, std::size_t size) : array(array), size(size) {
-            char* start = reinterpret_cast<char*>(array);
-            char* end = reinterpret_cast<char*>(array + size);
-            setg(start, start, end);
-            setp(start, end);
+#if defined(__unix__) || defined(__APPLE__)
+#define LEMLIB_PATH_HAS_UNISTD
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lemlib {
+namespace PathFileSystem {
+
+using namespace lemlib;
+
+bool decode(const uint8_t* fileBuffer, const size_t fileSize, PathFile& output) {
+    try {
+        PathFileView view(fileBuffer, fileSize);
+        if (!view.valid() || !view.verify()) return false;
+
+        copyFileMetadata(view.metadata(), output.metadata);
+        output.paths.reserve(output.paths.size() + view.pathCount());
+
+        PathCursor paths = view.paths();
+        PathView p;
+        while (paths.next(p)) {
+            // built in place so it allocates from the memory resource of output
+            if (!decode(p, paths.waypoints(), output.paths.emplace_back())) return false;
         }
 
-        virtual std::streamsize xsputn(const char* s, std::streamsize n) override {
-            std::size_t remaining = size - (pptr() - pbase());
-            std::streamsize to_write = std::min(n, static_cast<std::streamsize>(remaining));
-            std::copy(s, s + to_write, pptr());
-            pbump(static_cast<int>(to_write));
-            return to_write;
+        return !paths.failed();
+    } catch (std::exception& e) { return false; }
+}
+
+bool decodeInto(const uint8_t* fileBuffer, const size_t fileSize, PathFile& output) {
+    try {
+        PathFileView view(fileBuffer, fileSize);
+        if (!view.valid() || !view.verify()) return false;
+
+        copyFileMetadata(view.metadata(), output.metadata);
+        // existing paths keep their name and waypoint storage, only missing ones are created
+        output.paths.resize(view.pathCount());
+
+        PathCursor paths = view.paths();
+        PathView p;
+        for (Path& out : output.paths) {
+            if (!paths.next(p) || !decode(p, paths.waypoints(), out)) return false;
         }
-};
 
-template <class T> T readBuf(T& item, std::istream& in) {
-    in.read(reinterpret_cast<char*>(&item), sizeof(T));
-    return item;
+        return true;
+    } catch (std::exception& e) { return false; }
+}
+
+size_t encodedSize(const Path& input, const EncodeOptions& options) { return encodedPathSize(input, options); }
+
+size_t encodedSize(const PathFile& input, const EncodeOptions& options) { return encodedFileSize(input, options); }
+
+static bool isEncodable(const PathFile& input, const EncodeOptions& options) { return isEncodableFile(input, options); }
+
+uint8_t* encode(const Path& input, uint8_t* dst, const EncodeOptions& options) {
+    if (!isEncodablePath(input)) return nullptr;
+    return encodePath(input, dst, options);
+}
+
+bool encode(const PathFile& input, uint8_t* fileBuffer, size_t& fileSize, const EncodeOptions& options) {
+    return encodeFile(input, fileBuffer, fileSize, options);
+}
+
+bool encode(const PathFile& input, std::vector<uint8_t>& output, const EncodeOptions& options) {
+    try {
+        if (!isEncodable(input, options)) return false;
+        output.resize(encodedSize(input, options));
+        size_t size = output.size();
+        return encode(input, output.data(), size, options);
+    } catch (std::exception& e) { return false; }
+}
+
+// fills offsets with the start of every path, followed by the end of the last one
+static void pathOffsets(const PathFile& input, unsigned threads, const EncodeOptions& options,
+                        std::vector<size_t>& offsets) {
+    offsets.resize(input.paths.size() + 1);
+    offsets[0] = headerSize(input, options);
+    parallelFor(input.paths.size(), threads, [&](size_t i) { offsets[i + 1] = encodedSize(input.paths[i], options); });
+    for (size_t i = 0; i < input.paths.size(); i++) offsets[i + 1] += offsets[i];
 }
 
-static void readBuf(uint8_t* buf, const size_t size, std::istream& in) { in.read(reinterpret_cast<char*>(buf), size); }
+static bool encodeParallel(const PathFile& input, const std::vector<size_t>& offsets, uint8_t* fileBuffer,
+                           unsigned threads, const EncodeOptions& options) {
+    encodeHeader(input, fileBuffer, options);
+    // every path is checksummed by the thread that wrote it while it is still in cache, then the checksums are
+    // combined
+    std::vector<uint32_t> checksums(options.header ? input.paths.size() : 0);
+    std::atomic<bool> ok(true);
+    parallelFor(input.paths.size(), threads, [&](size_t i) {
+        if (encodePath(input.paths[i], fileBuffer + offsets[i], options) != fileBuffer + offsets[i + 1]) ok = false;
+        if (options.header) checksums[i] = crc32c(fileBuffer + offsets[i], offsets[i + 1] - offsets[i]);
+    });
 
-static std::string readNTBS(size_t maxSize, std::istream& in) {
-    std::string rtn = "";
-    char now;
-    for (size_t i = 0; i < maxSize; i++) {
-        readBuf(now, in);
-        if (now == (char)0x00) break;
-        rtn += now;
+    const size_t fileSize = encodeEditorData(fileBuffer + offsets.back(), options) - fileBuffer;
+    if (options.header) {
+        uint32_t crc = crc32c(fileBuffer + format::fileHeaderSize, offsets[0] - format::fileHeaderSize);
+        for (size_t i = 0; i < checksums.size(); i++)
+            crc = crc32cCombine(crc, checksums[i], offsets[i + 1] - offsets[i]);
+        crc = crc32c(fileBuffer + offsets.back(), options.editorData.size, crc);
+        sealHeader(fileBuffer, fileSize, crc);
     }
-    return rtn;
+    return ok;
 }
 
-namespace lemlib {
-namespace PathFileSystem {
+bool encodeParallel(const PathFile& input, uint8_t* fileBuffer, size_t& fileSize, unsigned threads,
+                    const EncodeOptions& options) {
+    try {
+        if (!isEncodable(input, options)) return false;
+        std::vector<size_t> offsets;
+        pathOffsets(input, threads, options, offsets);
+        const size_t size = offsets.back() + options.editorData.size;
+        if (size > fileSize || !fitsHeader(size, options)) return false;
 
-using namespace lemlib;
+        if (!encodeParallel(input, offsets, fileBuffer, threads, options)) return false;
+        fileSize = size;
+        return true;
+    } catch (std::exception& e) { return false; }
+}
 
-bool decode(const uint8_t* fileBuffer, const size_t fileSize, PathFile& output) {
+bool encodeParallel(const PathFile& input, std::vector<uint8_t>& output, unsigned threads,
+                    const EncodeOptions& options) {
     try {
-        uint8_t metadata[256];
-        uint8_t metadataSize;
-        uint16_t pathCount;
-        uint32_t waypointCount;
-        uint8_t flag;
-        uint16_t ignored;
+        if (!isEncodable(input, options)) return false;
+        std::vector<size_t> offsets;
+        pathOffsets(input, threads, options, offsets);
+        const size_t size = offsets.back() + options.editorData.size;
+        if (!fitsHeader(size, options)) return false;
+        output.resize(size);
+        return encodeParallel(input, offsets, output.data(), threads, options);
+    } catch (std::exception& e) { return false; }
+}
 
-        ArrayStreamBuffer sbuf((uint8_t*)fileBuffer, fileSize);
-        std::istream in(&sbuf);
+#ifdef LEMLIB_PATH_HAS_UNISTD
+static bool writeAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
 
-        // Start reading metadata
-        readBuf(metadataSize, in);
-        readBuf(metadata, metadataSize, in);
+static bool writeAllAt(int fd, const uint8_t* data, size_t size, off_t offset) {
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd, data, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
 
-        // End reading metadata
+// where the file starts in fd, or -1 if the header cannot be written over once the body is out: pipes and serial
+// ports cannot seek, and writes to a file opened with O_APPEND always land at its end
+static off_t rewritableOffset(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) return -1;
+    const int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || (flags & O_APPEND) != 0) return -1;
+    return lseek(fd, 0, SEEK_CUR);
+}
 
-        readBuf(pathCount, in);
+// the checksum of the body ahead of writing it, given the file up to the paths; fileSize is the size of that part on
+// input and of the whole file on output. Every path is encoded into one scratch buffer, grown to the largest path
+static uint32_t bodyChecksum(const PathFile& input, const uint8_t* file, size_t& fileSize,
+                             const EncodeOptions& options) {
+    uint32_t crc = crc32c(file + format::fileHeaderSize, fileSize - format::fileHeaderSize);
+    std::vector<uint8_t> scratch;
+    for (const Path& p : input.paths) {
+        const size_t size = encodedSize(p, options);
+        if (size > scratch.size()) scratch.resize(size);
+        encodePath(p, scratch.data(), options);
+        crc = crc32c(scratch.data(), size, crc);
+        fileSize += size;
+    }
+    fileSize += options.editorData.size;
+    return crc32c(options.editorData.data, options.editorData.size, crc);
+}
+#endif
 
-        for (int i = 0; i < pathCount; i++) {
-            Path p;
+bool encodeToFile(const PathFile& input, int fd, const EncodeOptions& options) {
+#ifdef LEMLIB_PATH_HAS_UNISTD
+    try {
+        if (!isEncodable(input, options)) return false;
 
-            p.name = readNTBS(1024, in);
+        // paths are encoded into the staging buffer and flushed whenever the next one does not fit
+        std::vector<uint8_t> staging(64 * 1024);
+        size_t used = encodeHeader(input, staging.data(), options) - staging.data();
+        size_t fileSize = used;
 
-            // Start reading metadata
-            readBuf(metadataSize, in);
-            readBuf(metadata, metadataSize, in);
+        // A regular file gets the header written over its start once the body is out, with the checksum taken as
+        // the staging buffer is flushed. Pipes and serial ports cannot seek back, so there the body is encoded once
+        // more beforehand for its checksum.
+        const off_t start = options.header ? rewritableOffset(fd) : -1;
+        const bool sealAfter = start >= 0;
+        uint8_t header[format::fileHeaderSize];
+        if (sealAfter) {
+            memcpy(header, staging.data(), sizeof(header));
+        } else if (options.header) {
+            size_t size = used;
+            const uint32_t crc = bodyChecksum(input, staging.data(), size, options);
+            if (!fitsHeader(size, options)) return false;
+            sealHeader(staging.data(), size, crc);
+        }
 
-            // End reading metadata
+        uint32_t crc = 0;
+        size_t unchecked = options.header ? format::fileHeaderSize : 0;
+        auto flush = [&]() {
+            if (sealAfter) crc = crc32c(staging.data() + unchecked, used - unchecked, crc);
+            unchecked = 0;
+            const bool written = writeAll(fd, staging.data(), used);
+            used = 0;
+            return written;
+        };
 
-            readBuf(waypointCount, in);
+        for (const Path& p : input.paths) {
+            const size_t size = encodedSize(p, options);
+            fileSize += size;
+            if (!fitsHeader(fileSize + options.editorData.size, options)) return false;
+            if (used + size > staging.size()) {
+                if (!flush()) return false;
+                if (size > staging.size()) staging.resize(size);
+            }
+            used = encodePath(p, staging.data() + used, options) - staging.data();
+        }
 
-            for (int j = 0; j < waypointCount; j++) {
-                Waypoint w;
+        // the editor data is already contiguous, so it skips the staging buffer
+        if (!flush() || !writeAll(fd, options.editorData.data, options.editorData.size)) return false;
+        if (!sealAfter) return true;
 
-                readBuf(flag, in);
-                readBuf(w.x, in);
-                readBuf(w.y, in);
-                readBuf(w.speed, in);
+        crc = crc32c(options.editorData.data, options.editorData.size, crc);
+        sealHeader(header, fileSize + options.editorData.size, crc);
+        return writeAllAt(fd, header, sizeof(header), start);
+    } catch (std::exception& e) { return false; }
+#else
+    (void)input;
+    (void)fd;
+    (void)options;
+    return false;
+#endif
+}
 
-                if ((w.isHeadingAvailable = (flag & 0x01) != 0)) readBuf(w.heading, in);
-                if ((w.isLookaheadAvailable = (flag & 0x02) != 0)) readBuf(w.lookahead, in);
-                if ((flag & 0x04) != 0) readBuf(ignored, in);
-                if ((flag & 0x08) != 0) readBuf(ignored, in);
-                if ((flag & 0x10) != 0) readBuf(ignored, in);
-                if ((flag & 0x20) != 0) readBuf(ignored, in);
-                if ((flag & 0x40) != 0) readBuf(ignored, in);
-                if ((flag & 0x80) != 0) readBuf(ignored, in);
+bool decodeParallel(const uint8_t* fileBuffer, const size_t fileSize, PathFile& output, unsigned threads) {
+    try {
+        std::vector<PathIndexEntry> index;
+        if (!scan(fileBuffer, fileSize, index)) return false;
+        const PathFileView file(fileBuffer, fileSize);
+        const WaypointEncoding encoding = file.encoding();
+        copyFileMetadata(file.metadata(), output.metadata);
 
-                p.waypoints.push_back(w);
-            }
+        const size_t base = output.paths.size();
+        output.paths.resize(base + index.size());
 
-            output.paths.push_back(p);
-        }
+        std::atomic<bool> ok(true);
+        parallelFor(index.size(), threads, [&](size_t i) {
+            try {
+                PathView view;
+                const uint8_t* begin = fileBuffer + index[i].offset;
+                if (!PathView::parse(begin, begin + index[i].size, encoding, view) ||
+                    !decode(view, output.paths[base + i]))
+                    ok = false;
+            } catch (std::exception& e) { ok = false; }
+        });
 
-        return true;
+        return ok;
     } catch (std::exception& e) { return false; }
 }
 
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <memory_resource>
 #include <vector>
 #include <string>
 
@@ -18,22 +19,133 @@ struct Waypoint {
         bool isLookaheadAvailable : 1;
 };
 
+// The parameters behind flag bits 0x04 to 0x80 of one waypoint, which newer editors write and this version does
+// not interpret. Kept so they are written back unchanged.
+struct UnknownParameters {
+        uint32_t waypoint; // index in Path::waypoints
+        uint8_t flags; // the unknown bits of the flag byte, never 0
+        uint16_t values[6]; // one per set bit, lowest bit first
+};
+
+// Path and PathFile are allocator-aware: give a PathFile a memory resource, for example a
+// std::pmr::monotonic_buffer_resource, and every path, name and waypoint decoded into it is allocated there.
 class Path {
     public:
-        std::string name;
-        std::vector<Waypoint> waypoints;
+        using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+        std::pmr::string name;
+        // (key, length, value) entries, see metadata.hpp
+        std::pmr::vector<uint8_t> metadata;
+        std::pmr::vector<Waypoint> waypoints;
+        // sorted by waypoint, only for the waypoints that have any; empty for paths written by this version
+        std::pmr::vector<UnknownParameters> unknownParameters;
 
         Path() = default;
+
+        explicit Path(const allocator_type& alloc)
+            : name(alloc), metadata(alloc), waypoints(alloc), unknownParameters(alloc) {}
+
+        Path(const Path& that) = default;
+        Path(Path&& that) = default;
+
+        Path(const Path& that, const allocator_type& alloc)
+            : name(that.name, alloc), metadata(that.metadata, alloc), waypoints(that.waypoints, alloc),
+              unknownParameters(that.unknownParameters, alloc) {}
+
+        Path(Path&& that, const allocator_type& alloc)
+            : name(std::move(that.name), alloc), metadata(std::move(that.metadata), alloc),
+              waypoints(std::move(that.waypoints), alloc),
+              unknownParameters(std::move(that.unknownParameters), alloc) {}
+
+        Path& operator=(const Path& that) = default;
+        Path& operator=(Path&& that) = default;
+
+        allocator_type get_allocator() const { return name.get_allocator(); }
 };
 
 class PathFile {
     public:
-        std::vector<Path> paths;
+        using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+        // the file metadata, without the entries the format itself uses
+        std::pmr::vector<uint8_t> metadata;
+        std::pmr::vector<Path> paths;
 
         PathFile() = default;
+
+        explicit PathFile(const allocator_type& alloc) : metadata(alloc), paths(alloc) {}
+
+        PathFile(const PathFile& that) = default;
+        PathFile(PathFile&& that) = default;
+
+        PathFile(const PathFile& that, const allocator_type& alloc)
+            : metadata(that.metadata, alloc), paths(that.paths, alloc) {}
+
+        PathFile(PathFile&& that, const allocator_type& alloc)
+            : metadata(std::move(that.metadata), alloc), paths(std::move(that.paths), alloc) {}
+
+        PathFile& operator=(const PathFile& that) = default;
+        PathFile& operator=(PathFile&& that) = default;
+
+        allocator_type get_allocator() const { return paths.get_allocator(); }
+};
+
+// The layout of the waypoint records, stored in the file metadata. Every decoder reads both.
+enum class WaypointEncoding : uint8_t {
+    Plain = 0, // fixed-size fields, at least 7 bytes per waypoint
+    Delta = 1 // zigzag varint differences to the previous waypoint, usually 4 to 6 bytes per waypoint
+};
+
+struct ByteSpan {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+};
+
+struct EncodeOptions {
+        WaypointEncoding waypoints = WaypointEncoding::Plain;
+        // Starts the file with the versioned header and the CRC32C of the rest, so truncated or corrupted files are
+        // refused by decode(). Turn off only for readers older than the header.
+        bool header = true;
+        // Copied verbatim after the last path, e.g. PathFileView::editorData() of the file being saved again. The
+        // bytes are only read while encoding and are covered by the checksum.
+        ByteSpan editorData;
 };
 
+// appends the paths of the file to output and replaces its metadata
 bool decode(const uint8_t* fileBuffer, const size_t fileSize, PathFile& output);
+// Replaces the paths of output, reusing the storage of the paths and waypoints already there. Decoding a file
+// of the same shape again does not allocate.
+bool decodeInto(const uint8_t* fileBuffer, const size_t fileSize, PathFile& output);
+
+// The exact number of bytes encode() writes. For the plain layout it follows from name lengths and flag bits alone.
+size_t encodedSize(const Path& input, const EncodeOptions& options = {});
+size_t encodedSize(const PathFile& input, const EncodeOptions& options = {});
+
+// fileSize is the capacity of fileBuffer on input and the encoded size on output
+bool encode(const PathFile& input, uint8_t* fileBuffer, size_t& fileSize, const EncodeOptions& options = {});
+// replaces the contents of output, allocating exactly once
+bool encode(const PathFile& input, std::vector<uint8_t>& output, const EncodeOptions& options = {});
+
+// Writes the record of a single path, exactly encodedSize(input, options) bytes, and returns the end of it.
+// Returns nullptr without writing when the name or waypoint count cannot be represented.
+uint8_t* encode(const Path& input, uint8_t* dst, const EncodeOptions& options = {});
+
+// Writes to a file descriptor through a small staging buffer. With a header, a regular file gets it written at the
+// offset it started from once the body is out; pipes, serial ports and files opened with O_APPEND cannot take it
+// back, so the body is encoded twice, once for the checksum and once to write it.
+bool encodeToFile(const PathFile& input, int fd, const EncodeOptions& options = {});
+
+// Same bytes as encode(): per-path sizes are computed in parallel and prefix-summed into offsets, then every
+// path is written concurrently into its own range of the output. threads = 0 uses every hardware thread.
+bool encodeParallel(const PathFile& input, uint8_t* fileBuffer, size_t& fileSize, unsigned threads = 0,
+                    const EncodeOptions& options = {});
+bool encodeParallel(const PathFile& input, std::vector<uint8_t>& output, unsigned threads = 0,
+                    const EncodeOptions& options = {});
+
+// Scans the path boundaries, then decodes the paths on a work-stealing pool straight into their slots of
+// output.paths. Produces the same paths as decode(); threads = 0 uses every hardware thread. The memory
+// resource of output, if any, must be thread-safe, e.g. std::pmr::synchronized_pool_resource.
+bool decodeParallel(const uint8_t* fileBuffer, const size_t fileSize, PathFile& output, unsigned threads = 0);
 
 } // namespace PathFileSystem
 } // namespace lemlib
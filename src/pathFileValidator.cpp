@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstring>
+#include "pathFileValidator.hpp"
+#include "pathFileSystem.hpp"
+#include "pathFileFormat.hpp"
+#include "deltaCodec.hpp"
+#include "crc32c.hpp"
+#include "metadata.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// The end of the delta record at src, or nullptr if it runs past end or a field does not fit in 16 bits. Only the
+// varint boundaries matter, so nothing is decoded.
+static const uint8_t* checkDelta(const uint8_t* src, const uint8_t* end) {
+    if (src == end) return nullptr;
+    const size_t fields = format::fieldCount(*src++);
+    if ((size_t)(end - src) >= format::maxDeltaRecordSize) {
+        // the longest record fits, so the field lengths come from the continuation bits without a branch
+        bool malformed = false;
+        for (size_t i = 0; i < fields; i++) {
+            const unsigned second = src[0] >> 7;
+            const unsigned third = second & (src[1] >> 7);
+            malformed |= third & (src[2] > 0x03);
+            src += 1 + second + third;
+        }
+        return malformed ? nullptr : src;
+    }
+    for (size_t i = 0; i < fields; i++) {
+        if (src == end) return nullptr;
+        if (*src++ < 0x80) continue;
+        if (src == end) return nullptr;
+        if (*src++ < 0x80) continue;
+        if (src == end || *src++ > 0x03) return nullptr;
+    }
+    return src;
+}
+
+// the same rules as PathFileView, PathView::parse() and the waypoint cursors, with a reason for every refusal
+ValidationResult validate(const uint8_t* fileBuffer, size_t fileSize) {
+    const uint8_t* ptr = fileBuffer;
+    const uint8_t* end = fileBuffer + fileSize;
+    auto fail = [&](ValidationError error, const uint8_t* at) {
+        return ValidationResult {error, (size_t)(at - fileBuffer)};
+    };
+
+    if (fileSize >= sizeof(format::magic) && memcmp(fileBuffer, format::magic, sizeof(format::magic)) == 0) {
+        if (fileSize < format::fileHeaderSize) return fail(ValidationError::TruncatedHeader, end);
+        if (fileBuffer[format::versionOffset] != format::version)
+            return fail(ValidationError::UnsupportedVersion, fileBuffer + format::versionOffset);
+        const uint32_t bodySize = format::load<uint32_t>(fileBuffer + format::bodySizeOffset);
+        if (fileSize - format::fileHeaderSize < bodySize)
+            return fail(ValidationError::TruncatedBody, fileBuffer + format::bodySizeOffset);
+        ptr = fileBuffer + format::fileHeaderSize;
+        end = ptr + bodySize;
+        if (crc32c(ptr, bodySize) != format::load<uint32_t>(fileBuffer + format::checksumOffset))
+            return fail(ValidationError::ChecksumMismatch, fileBuffer + format::checksumOffset);
+    }
+
+    if (ptr == end || (size_t)(end - ptr - 1) < *ptr) return fail(ValidationError::TruncatedMetadata, ptr);
+    WaypointEncoding encoding = WaypointEncoding::Plain;
+    MetadataReader entries({ptr + 1, *ptr});
+    MetadataEntry entry;
+    while (entries.next(entry)) {
+        if (entry.key != format::waypointEncodingTag || entry.value.size == 0) continue;
+        if (entry.value.data[0] > (uint8_t)WaypointEncoding::Delta)
+            return fail(ValidationError::UnknownWaypointEncoding, entry.value.data);
+        encoding = (WaypointEncoding)entry.value.data[0];
+    }
+    ptr += 1 + *ptr;
+
+    if ((size_t)(end - ptr) < sizeof(uint16_t)) return fail(ValidationError::TruncatedPathCount, ptr);
+    const uint16_t pathCount = format::load<uint16_t>(ptr);
+    ptr += sizeof(uint16_t);
+
+    for (uint16_t i = 0; i < pathCount; i++) {
+        const size_t nameLimit = std::min<size_t>(end - ptr, format::maxNameLength);
+        const uint8_t* nul = static_cast<const uint8_t*>(memchr(ptr, 0x00, nameLimit));
+        if (nul == nullptr && nameLimit < format::maxNameLength) return fail(ValidationError::TruncatedName, ptr);
+        ptr = nul != nullptr ? nul + 1 : ptr + nameLimit;
+
+        if (ptr == end || (size_t)(end - ptr - 1) < *ptr) return fail(ValidationError::TruncatedPathMetadata, ptr);
+        ptr += 1 + *ptr;
+
+        if ((size_t)(end - ptr) < sizeof(uint32_t)) return fail(ValidationError::TruncatedWaypointCount, ptr);
+        const uint32_t waypointCount = format::load<uint32_t>(ptr);
+        ptr += sizeof(uint32_t);
+
+        if (encoding == WaypointEncoding::Plain) {
+            const uint8_t* records = ptr;
+            if (format::skipWaypoints(records, end, waypointCount) != waypointCount)
+                return fail(ValidationError::TruncatedWaypoint, records);
+            ptr = records;
+            continue;
+        }
+
+        if ((size_t)(end - ptr) < sizeof(uint32_t)) return fail(ValidationError::TruncatedBlockSize, ptr);
+        const uint32_t blockSize = format::load<uint32_t>(ptr);
+        if ((size_t)(end - ptr - sizeof(uint32_t)) < blockSize) return fail(ValidationError::BlockPastEnd, ptr);
+        ptr += sizeof(uint32_t);
+        const uint8_t* blockEnd = ptr + blockSize;
+        for (uint32_t j = 0; j < waypointCount; j++) {
+            const uint8_t* next = checkDelta(ptr, blockEnd);
+            if (next == nullptr) {
+                const bool complete = deltaRecordSize(ptr, blockEnd) != 0;
+                return fail(complete ? ValidationError::MalformedWaypoint : ValidationError::TruncatedWaypoint, ptr);
+            }
+            ptr = next;
+        }
+        // records that do not fill the block leave the rest unused
+        ptr = blockEnd;
+    }
+
+    return {};
+}
+
+const char* toString(ValidationError error) {
+    switch (error) {
+        case ValidationError::None: return "none";
+        case ValidationError::TruncatedHeader: return "truncated header";
+        case ValidationError::UnsupportedVersion: return "unsupported version";
+        case ValidationError::TruncatedBody: return "truncated body";
+        case ValidationError::ChecksumMismatch: return "checksum mismatch";
+        case ValidationError::TruncatedMetadata: return "truncated metadata";
+        case ValidationError::UnknownWaypointEncoding: return "unknown waypoint encoding";
+        case ValidationError::TruncatedPathCount: return "truncated path count";
+        case ValidationError::TruncatedName: return "truncated name";
+        case ValidationError::TruncatedPathMetadata: return "truncated path metadata";
+        case ValidationError::TruncatedWaypointCount: return "truncated waypoint count";
+        case ValidationError::TruncatedBlockSize: return "truncated block size";
+        case ValidationError::BlockPastEnd: return "block past end";
+        case ValidationError::TruncatedWaypoint: return "truncated waypoint";
+        case ValidationError::MalformedWaypoint: return "malformed waypoint";
+    }
+    return "unknown";
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace lemlib {
+namespace PathFileSystem {
+
+enum class ValidationError : uint8_t {
+    None,
+    TruncatedHeader, // the file starts with the magic, but not with a whole header
+    UnsupportedVersion,
+    TruncatedBody, // the header promises more bytes than the file has
+    ChecksumMismatch,
+    TruncatedMetadata,
+    UnknownWaypointEncoding,
+    TruncatedPathCount,
+    TruncatedName, // the buffer ends before the null byte of a name shorter than maxNameLength
+    TruncatedPathMetadata,
+    TruncatedWaypointCount,
+    TruncatedBlockSize,
+    BlockPastEnd, // the record block of a delta path
+    TruncatedWaypoint,
+    MalformedWaypoint // a delta field that does not fit in 16 bits
+};
+
+struct ValidationResult {
+        ValidationError error = ValidationError::None;
+        size_t offset = 0; // from the start of the buffer, of the field that failed
+
+        bool ok() const { return error == ValidationError::None; }
+};
+
+// Checks every length, count, name and waypoint record of a file against the bounds of the buffer, and the
+// checksum if there is a header, without allocating or decoding anything. Accepts exactly the files decode()
+// accepts.
+ValidationResult validate(const uint8_t* fileBuffer, size_t fileSize);
+
+const char* toString(ValidationError error);
+
+} // namespace PathFileSystem
+} // namespace lemlib
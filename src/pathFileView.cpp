@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+#include "pathFileView.hpp"
+#include "crc32c.hpp"
+#include "metadata.hpp"
+#include "unknownParameters.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+bool WaypointCursor::nextDelta(Waypoint& w) {
+    const uint8_t* p = decodeDelta(ptr, end, state, w);
+    if (p == nullptr) return error = true, false;
+    ptr = p;
+    left--;
+    return true;
+}
+
+uint32_t WaypointCursor::skip(uint32_t n) {
+    if (error) return 0;
+    n = std::min(n, left);
+
+    if (encoding != WaypointEncoding::Plain) {
+        // the path ends exactly at the end of its record block, so skipping the rest needs no decoding
+        if (n == left) {
+            ptr = end;
+            left = 0;
+            return n;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            const uint8_t* p = skipDelta(ptr, end, state);
+            if (p == nullptr) return error = true, i;
+            ptr = p;
+            left--;
+        }
+        return n;
+    }
+
+    const uint32_t i = format::skipWaypoints(ptr, end, n);
+    left -= i;
+    if (i < n) error = true;
+    return i;
+}
+
+using ColumnReader = size_t (WaypointCursor::*)(const WaypointColumns&, size_t);
+
+template <unsigned... Fields>
+static constexpr std::array<ColumnReader, sizeof...(Fields)> columnReaders(std::integer_sequence<unsigned, Fields...>) {
+    return {&WaypointCursor::read<Fields>...};
+}
+
+size_t WaypointCursor::read(const WaypointColumns& output, size_t max) {
+    // an instance of the loop per mask of columns, so neither the records nor the kernels test them
+    static constexpr std::array<ColumnReader, 0x40> readers =
+        columnReaders(std::make_integer_sequence<unsigned, 0x40>());
+    return (this->*readers[columnFields(output)])(output, max);
+}
+
+bool PathView::parse(const uint8_t* begin, const uint8_t* end, WaypointEncoding encoding, PathView& output) {
+    const uint8_t* ptr = begin;
+
+    // same rule as decode(): the name stops at a null byte or after maxNameLength characters
+    const size_t nameLimit = std::min<size_t>(end - ptr, format::maxNameLength);
+    const uint8_t* nul = static_cast<const uint8_t*>(memchr(ptr, 0x00, nameLimit));
+    if (nul == nullptr && nameLimit < format::maxNameLength) return false;
+    output.namePtr = reinterpret_cast<const char*>(ptr);
+    output.nameLength = nul != nullptr ? nul - ptr : nameLimit;
+    ptr += nul != nullptr ? output.nameLength + 1 : nameLimit;
+
+    if (ptr == end) return false;
+    output.meta.size = *ptr++;
+    if ((size_t)(end - ptr) < output.meta.size) return false;
+    output.meta.data = ptr;
+    ptr += output.meta.size;
+
+    if ((size_t)(end - ptr) < sizeof(uint32_t)) return false;
+    output.count = format::load<uint32_t>(ptr);
+    ptr += sizeof(uint32_t);
+
+    output.encoding = encoding;
+    if (encoding != WaypointEncoding::Plain) {
+        // the delta records are preceded by their size in bytes
+        if ((size_t)(end - ptr) < sizeof(uint32_t)) return false;
+        const uint32_t blockSize = format::load<uint32_t>(ptr);
+        ptr += sizeof(uint32_t);
+        if ((size_t)(end - ptr) < blockSize) return false;
+        end = ptr + blockSize;
+    }
+
+    output.body = ptr;
+    output.end = end;
+    return true;
+}
+
+PathCursor::PathCursor(const uint8_t* begin, const uint8_t* end, uint16_t count, WaypointEncoding encoding)
+    : ptr(begin), end(end), left(count), encoding(encoding) {}
+
+bool PathCursor::next(PathView& output) {
+    if (error) return false;
+
+    // finish skipping the previous path before reading the next header
+    pending.skip(pending.remaining());
+    if (pending.failed()) return error = true, false;
+    if (pending.position() != nullptr) ptr = pending.position();
+
+    if (left == 0) return false;
+    if (!PathView::parse(ptr, end, encoding, output)) return error = true, false;
+
+    pending = output.waypoints();
+    left--;
+    return true;
+}
+
+PathFileView::PathFileView(const uint8_t* fileBuffer, const size_t fileSize)
+    : buffer(fileBuffer), end(fileBuffer + fileSize) {
+    if (fileSize >= sizeof(format::magic) && memcmp(fileBuffer, format::magic, sizeof(format::magic)) == 0) {
+        if (fileSize < format::fileHeaderSize) return;
+        formatVersion = fileBuffer[format::versionOffset];
+        if (formatVersion != format::version) return;
+        const uint32_t bodySize = format::load<uint32_t>(fileBuffer + format::bodySizeOffset);
+        checksum = format::load<uint32_t>(fileBuffer + format::checksumOffset);
+        if (fileSize - format::fileHeaderSize < bodySize) return;
+        // anything after the body is not covered by the checksum and not part of the file
+        buffer = fileBuffer + format::fileHeaderSize;
+        end = buffer + bodySize;
+    }
+
+    const uint8_t* ptr = buffer;
+
+    if (ptr == end) return;
+    meta.size = *ptr++;
+    if ((size_t)(end - ptr) < meta.size) return;
+    meta.data = ptr;
+    ptr += meta.size;
+
+    // metadata that is not a well-formed list of entries predates them and is ignored
+    MetadataReader entries(meta);
+    MetadataEntry entry;
+    while (entries.next(entry)) {
+        if (entry.key == format::waypointEncodingTag && entry.value.size >= 1) {
+            if (entry.value.data[0] > (uint8_t)WaypointEncoding::Delta) return;
+            waypointEncoding = (WaypointEncoding)entry.value.data[0];
+        }
+    }
+
+    if ((size_t)(end - ptr) < sizeof(uint16_t)) return;
+    count = format::load<uint16_t>(ptr);
+    ptr += sizeof(uint16_t);
+
+    first = ptr;
+    ok = true;
+}
+
+bool PathFileView::verify() const {
+    if (!hasHeader()) return true;
+    return crc32c(buffer, end - buffer) == checksum;
+}
+
+ByteSpan PathFileView::editorData() const {
+    if (!ok) return {};
+    PathCursor cursor = paths();
+    PathView p;
+    while (cursor.next(p)) {}
+    if (cursor.failed()) return {};
+    return {cursor.position(), (size_t)(end - cursor.position())};
+}
+
+bool decode(const PathView& view, Path& output) {
+    WaypointCursor waypoints = view.waypoints();
+    return decode(view, waypoints, output);
+}
+
+bool decode(const PathView& view, WaypointCursor& waypoints, Path& output) {
+    output.name = view.name();
+    output.metadata.assign(view.metadata().data, view.metadata().data + view.metadata().size);
+    output.waypoints.clear();
+    output.unknownParameters.clear();
+    // exact from the header count, but never trusted further than the bytes that are actually there
+    output.waypoints.reserve(std::min<size_t>(view.waypointCount(), waypoints.recordsThatFit()));
+
+    Waypoint w;
+    const uint8_t* record = waypoints.position();
+    while (waypoints.next(w)) {
+        if (*record & format::unknownFlags) {
+            output.unknownParameters.push_back(
+                loadUnknownParameters(record, view.waypointEncoding(), output.waypoints.size()));
+        }
+        output.waypoints.push_back(w);
+        record = waypoints.position();
+    }
+
+    return !waypoints.failed();
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include "pathFileSystem.hpp"
+#include "pathFileFormat.hpp"
+#include "waypointKernels.hpp"
+#include "deltaCodec.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// Walks the waypoint records of one path in place, decoding a waypoint per call to next()
+class WaypointCursor {
+    private:
+        const uint8_t* ptr = nullptr;
+        const uint8_t* end = nullptr;
+        uint32_t left = 0;
+        bool error = false;
+        WaypointEncoding encoding = WaypointEncoding::Plain;
+        DeltaState state; // the previous values, for the delta layout
+
+        bool nextDelta(Waypoint& w);
+        template <unsigned Fields> size_t readDelta(const WaypointColumns& output, size_t max);
+    public:
+        WaypointCursor() = default;
+        WaypointCursor(const uint8_t* begin, const uint8_t* end, uint32_t count,
+                       WaypointEncoding encoding = WaypointEncoding::Plain);
+
+        // returns false once the path is exhausted or a record runs past the end of the buffer
+        bool next(Waypoint& w);
+        bool skip();
+        // skips up to n records, returns the number skipped
+        uint32_t skip(uint32_t n);
+        // decodes up to max waypoints into the columns, runs of plain records sharing a flag byte go through the
+        // vectorized kernels; columns left nullptr are skipped. Returns the number decoded
+        size_t read(const WaypointColumns& output, size_t max);
+        // read() into the columns in Fields, a WaypointField mask known at compile time; the others are not written
+        // and may be nullptr. read() picks the instance for the columns that are not nullptr
+        template <unsigned Fields> size_t read(const WaypointColumns& output, size_t max);
+
+        uint32_t remaining() const { return left; }
+
+        bool failed() const { return error; }
+
+        const uint8_t* position() const { return ptr; }
+
+        size_t bytesLeft() const { return end - ptr; }
+
+        // an upper bound on the number of records in the bytes left
+        size_t recordsThatFit() const {
+            return bytesLeft() / (encoding == WaypointEncoding::Plain ? format::waypointHeaderSize
+                                                                       : format::minDeltaRecordSize);
+        }
+};
+
+template <unsigned Fields> size_t WaypointCursor::readDelta(const WaypointColumns& output, size_t max) {
+    size_t done = 0;
+    Waypoint w;
+    for (const uint8_t* record = ptr; done < max && nextDelta(w); done++, record = ptr) {
+        if constexpr ((Fields & WaypointX) != 0) output.x[done] = w.x;
+        if constexpr ((Fields & WaypointY) != 0) output.y[done] = w.y;
+        if constexpr ((Fields & WaypointSpeed) != 0) output.speed[done] = w.speed;
+        if constexpr ((Fields & WaypointHeading) != 0) output.heading[done] = w.isHeadingAvailable ? w.heading : 0;
+        if constexpr ((Fields & WaypointLookahead) != 0)
+            output.lookahead[done] = w.isLookaheadAvailable ? w.lookahead : 0;
+        if constexpr ((Fields & WaypointFlag) != 0) output.flag[done] = *record;
+    }
+    return done;
+}
+
+template <unsigned Fields> size_t WaypointCursor::read(const WaypointColumns& output, size_t max) {
+    max = std::min<size_t>(max, left);
+    if (encoding != WaypointEncoding::Plain) return readDelta<Fields>(output, max);
+
+    size_t done = 0;
+
+    while (done < max && !error) {
+        if (ptr == end) {
+            error = true;
+            break;
+        }
+        const uint8_t flag = ptr[0];
+        const format::RecordLayout& layout = format::recordLayout(flag);
+        const size_t stride = layout.size;
+        const size_t fit = (end - ptr) / stride;
+        if (fit == 0) {
+            error = true;
+            break;
+        }
+
+        // only look for a run where the 2nd, 4th and 8th records share the flag, which mixed flags seldom pass
+        const size_t limit = std::min(max - done, fit);
+        size_t n = 1;
+        if (limit >= 8 && ((ptr[stride] == flag) & (ptr[3 * stride] == flag) & (ptr[7 * stride] == flag))) {
+            while (n < limit && ptr[n * stride] == flag) n++;
+        }
+
+        if (n >= 8) {
+            decodeRun(ptr, end, flag, n, output.advanced(done), Fields);
+        } else {
+            // not worth a kernel dispatch
+            for (size_t i = 0; i < n; i++) {
+                const uint8_t* record = ptr + i * stride;
+                const size_t j = done + i;
+                if constexpr ((Fields & WaypointX) != 0) output.x[j] = format::load<int16_t>(record + 1);
+                if constexpr ((Fields & WaypointY) != 0) output.y[j] = format::load<int16_t>(record + 3);
+                if constexpr ((Fields & WaypointSpeed) != 0) output.speed[j] = format::load<int16_t>(record + 5);
+                if constexpr ((Fields & WaypointHeading) != 0)
+                    output.heading[j] = layout.heading ? format::load<uint16_t>(record + layout.heading) : 0;
+                if constexpr ((Fields & WaypointLookahead) != 0)
+                    output.lookahead[j] = layout.lookahead ? format::load<int16_t>(record + layout.lookahead) : 0;
+                if constexpr ((Fields & WaypointFlag) != 0) output.flag[j] = flag;
+            }
+        }
+        ptr += n * stride;
+        done += n;
+        left -= n;
+    }
+
+    return done;
+}
+
+class PathView {
+    private:
+        const char* namePtr = nullptr;
+        size_t nameLength = 0;
+        ByteSpan meta;
+        uint32_t count = 0;
+        const uint8_t* body = nullptr;
+        const uint8_t* end = nullptr;
+        WaypointEncoding encoding = WaypointEncoding::Plain;
+
+        friend class PathCursor;
+    public:
+        PathView() = default;
+
+        // parses the path header starting at begin, false if it does not fit in the buffer
+        static bool parse(const uint8_t* begin, const uint8_t* end, WaypointEncoding encoding, PathView& output);
+
+        std::string_view name() const { return std::string_view(namePtr, nameLength); }
+
+        ByteSpan metadata() const { return meta; }
+
+        uint32_t waypointCount() const { return count; }
+
+        WaypointEncoding waypointEncoding() const { return encoding; }
+
+        WaypointCursor waypoints() const { return WaypointCursor(body, end, count, encoding); }
+};
+
+// Iterates the paths of a file, skipping the waypoint records of the previous path by their flag bytes, or all at
+// once in the delta layout
+class PathCursor {
+    private:
+        const uint8_t* ptr = nullptr;
+        const uint8_t* end = nullptr;
+        uint16_t left = 0;
+        WaypointCursor pending;
+        bool error = false;
+        WaypointEncoding encoding = WaypointEncoding::Plain;
+    public:
+        PathCursor() = default;
+        PathCursor(const uint8_t* begin, const uint8_t* end, uint16_t count, WaypointEncoding encoding);
+
+        bool next(PathView& output);
+
+        // the records of the current path; whatever is read through it does not have to be skipped again
+        WaypointCursor& waypoints() { return pending; }
+
+        uint16_t remaining() const { return left; }
+
+        bool failed() const { return error; }
+
+        // the start of the current path, or the end of the last one once next() has returned false
+        const uint8_t* position() const { return ptr; }
+};
+
+// A zero-copy, allocation-free view over an encoded path file. The buffer must outlive the view.
+class PathFileView {
+    private:
+        const uint8_t* buffer = nullptr;
+        const uint8_t* end = nullptr;
+        ByteSpan meta;
+        uint16_t count = 0;
+        const uint8_t* first = nullptr;
+        WaypointEncoding waypointEncoding = WaypointEncoding::Plain;
+        uint8_t formatVersion = 0;
+        uint32_t checksum = 0;
+        bool ok = false;
+    public:
+        PathFileView() = default;
+        PathFileView(const uint8_t* fileBuffer, const size_t fileSize);
+
+        // False if the header does not fit, the body is shorter than the header says (a truncated file), or the
+        // version or waypoint encoding is one this version does not know. The checksum is only checked by verify().
+        bool valid() const { return ok; }
+
+        // true if the file starts with the versioned header; files without one are still read
+        bool hasHeader() const { return formatVersion != 0; }
+
+        // 0 for files without a header
+        uint8_t version() const { return formatVersion; }
+
+        // the bytes the checksum covers, everything after the header; the whole file if it has none
+        ByteSpan body() const { return {buffer, (size_t)(end - buffer)}; }
+
+        // checks the CRC32C of the body at memory bandwidth; true for files without a header
+        bool verify() const;
+
+        ByteSpan metadata() const { return meta; }
+
+        uint16_t pathCount() const { return count; }
+
+        WaypointEncoding encoding() const { return waypointEncoding; }
+
+        const uint8_t* firstPath() const { return first; }
+
+        PathCursor paths() const { return PathCursor(first, end, count, waypointEncoding); }
+
+        // The bytes after the last path, up to the end of the body, which the path editor keeps for itself. Found by
+        // skipping every path, by its flag bytes or by the block sizes of the delta layout; data is nullptr if a
+        // path runs past the end.
+        ByteSpan editorData() const;
+};
+
+// Materializes a viewed path into output, reusing its storage. False if the records run past the end of the
+// buffer.
+bool decode(const PathView& view, Path& output);
+// same, reading the records through the given cursor, e.g. PathCursor::waypoints() so they are not skipped again
+bool decode(const PathView& view, WaypointCursor& waypoints, Path& output);
+
+inline WaypointCursor::WaypointCursor(const uint8_t* begin, const uint8_t* end, uint32_t count,
+                                      WaypointEncoding encoding)
+    : ptr(begin), end(end), left(count), encoding(encoding) {}
+
+inline bool WaypointCursor::next(Waypoint& w) {
+    if (left == 0 || error) return false;
+    if (encoding != WaypointEncoding::Plain) return nextDelta(w);
+    if (ptr == end) return error = true, false;
+    const uint8_t flag = ptr[0];
+    const format::RecordLayout& layout = format::recordLayout(flag);
+    if ((size_t)(end - ptr) < layout.size) return error = true, false;
+
+    // absent fields are read from offset 0 and masked to 0, so there is no branch on the flag bits
+    const bool hasHeading = (flag & format::headingFlag) != 0;
+    const bool hasLookahead = (flag & format::lookaheadFlag) != 0;
+    w.x = format::load<int16_t>(ptr + 1);
+    w.y = format::load<int16_t>(ptr + 3);
+    w.speed = format::load<int16_t>(ptr + 5);
+    w.heading = format::load<uint16_t>(ptr + layout.heading) & -(uint16_t)hasHeading;
+    w.lookahead = (int16_t)(format::load<uint16_t>(ptr + layout.lookahead) & -(uint16_t)hasLookahead);
+    w.isHeadingAvailable = hasHeading;
+    w.isLookaheadAvailable = hasLookahead;
+
+    ptr += layout.size;
+    left--;
+    return true;
+}
+
+inline bool WaypointCursor::skip() {
+    if (left == 0 || error) return false;
+    if (encoding != WaypointEncoding::Plain) return skip(1) == 1;
+    if (ptr == end) return error = true, false;
+    const size_t size = format::recordSize(ptr[0]);
+    if ((size_t)(end - ptr) < size) return error = true, false;
+    ptr += size;
+    left--;
+    return true;
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstring>
+#include "pathFileWriter.hpp"
+#include "pathFileFormat.hpp"
+#include "crc32c.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LEMLIB_PATH_HAS_UIO
+#include <cerrno>
+#include <climits>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace lemlib {
+namespace PathFileSystem {
+
+void PathFileWriter::invalidate(size_t index) {
+    if (index < cache.size()) cache[index].valid = false;
+}
+
+void PathFileWriter::invalidateAll() {
+    for (CachedPath& c : cache) c.valid = false;
+}
+
+// an edit that changes the name, the metadata or the waypoint count would leave the cached header wrong
+static bool matches(const std::vector<uint8_t>& bytes, const Path& p) {
+    const size_t metadataOffset = p.name.size() + 2;
+    if (bytes.size() < metadataOffset + p.metadata.size() + sizeof(uint32_t)) return false;
+    if (memcmp(bytes.data(), p.name.data(), p.name.size()) != 0 || bytes[p.name.size()] != 0) return false;
+    if (bytes[metadataOffset - 1] != p.metadata.size() ||
+        !std::equal(p.metadata.begin(), p.metadata.end(), bytes.begin() + metadataOffset))
+        return false;
+    return format::load<uint32_t>(bytes.data() + metadataOffset + p.metadata.size()) == p.waypoints.size();
+}
+
+// Field by field rather than by memory, which has padding. Fields the encoding leaves out are compared as well;
+// a change to them only costs an encode that was not needed.
+static bool sameWaypoint(const Waypoint& a, const Waypoint& b) {
+    return a.x == b.x && a.y == b.y && a.speed == b.speed && a.heading == b.heading && a.lookahead == b.lookahead &&
+           a.isHeadingAvailable == b.isHeadingAvailable && a.isLookaheadAvailable == b.isLookaheadAvailable;
+}
+
+static bool sameUnknownParameters(const UnknownParameters& a, const UnknownParameters& b) {
+    return a.waypoint == b.waypoint && a.flags == b.flags && std::equal(a.values, a.values + 6, b.values);
+}
+
+// an edit to the waypoints or unknown parameters, in place or not, leaves the cached records wrong
+static bool sameRecords(const std::vector<Waypoint>& waypoints, const std::vector<UnknownParameters>& unknown,
+                        const Path& p) {
+    return std::equal(waypoints.begin(), waypoints.end(), p.waypoints.begin(), p.waypoints.end(), sameWaypoint) &&
+           std::equal(unknown.begin(), unknown.end(), p.unknownParameters.begin(), p.unknownParameters.end(),
+                      sameUnknownParameters);
+}
+
+bool PathFileWriter::prepare(const PathFile& input) {
+    if (input.paths.size() > UINT16_MAX) return false;
+    // the header of a file with the same metadata and no paths, with the path count patched in
+    PathFile empty;
+    empty.metadata = input.metadata;
+    EncodeOptions headerOptions = options;
+    headerOptions.editorData = {};
+    if (!encode(empty, header, headerOptions)) return false;
+    format::store<uint16_t>(header.data() + header.size() - sizeof(uint16_t), input.paths.size());
+
+    cache.resize(input.paths.size());
+    lastEncoded = 0;
+    for (size_t i = 0; i < input.paths.size(); i++) {
+        const Path& p = input.paths[i];
+        CachedPath& c = cache[i];
+        if (c.valid && matches(c.bytes, p) && sameRecords(c.waypoints, c.unknownParameters, p)) continue;
+
+        c.valid = false;
+        c.bytes.resize(encodedSize(p, options));
+        if (encode(p, c.bytes.data(), options) == nullptr) return false;
+        // the delta layout follows the waypoint count with the byte size of the records
+        c.headerSize = p.name.size() + 2 + p.metadata.size() + sizeof(uint32_t);
+        if (options.waypoints == WaypointEncoding::Delta) c.headerSize += sizeof(uint32_t);
+        if (options.header) c.checksum = crc32c(c.bytes.data(), c.bytes.size());
+        c.waypoints.assign(p.waypoints.begin(), p.waypoints.end());
+        c.unknownParameters.assign(p.unknownParameters.begin(), p.unknownParameters.end());
+        c.valid = true;
+        lastEncoded++;
+    }
+
+    if (options.header) {
+        // the checksum of the file follows from the cached ones without reading the paths again
+        size_t bodySize = header.size() - format::fileHeaderSize;
+        uint32_t crc = crc32c(header.data() + format::fileHeaderSize, bodySize);
+        for (const CachedPath& c : cache) {
+            crc = crc32cCombine(crc, c.checksum, c.bytes.size());
+            bodySize += c.bytes.size();
+        }
+        crc = crc32c(options.editorData.data, options.editorData.size, crc);
+        bodySize += options.editorData.size;
+        if (bodySize > UINT32_MAX) return false;
+        format::store<uint32_t>(header.data() + format::bodySizeOffset, bodySize);
+        format::store<uint32_t>(header.data() + format::checksumOffset, crc);
+    }
+    return true;
+}
+
+bool PathFileWriter::segments(const PathFile& input, std::vector<ByteSpan>& output) {
+    try {
+        if (!prepare(input)) return false;
+
+        output.clear();
+        output.reserve(2 + 2 * cache.size());
+        output.push_back({header.data(), header.size()});
+        for (const CachedPath& c : cache) {
+            output.push_back({c.bytes.data(), c.headerSize});
+            // an empty path has no waypoint block
+            if (c.bytes.size() > c.headerSize)
+                output.push_back({c.bytes.data() + c.headerSize, c.bytes.size() - c.headerSize});
+        }
+        if (options.editorData.size > 0) output.push_back(options.editorData);
+        return true;
+    } catch (std::exception& e) { return false; }
+}
+
+#ifdef LEMLIB_PATH_HAS_UIO
+// offset < 0 writes at the current position; partial writes resume inside the segment they stopped in
+static bool writeSegments(int fd, const std::vector<ByteSpan>& segments, int64_t offset) {
+    std::vector<struct iovec> iov;
+    iov.reserve(segments.size());
+    for (const ByteSpan& s : segments) iov.push_back({const_cast<uint8_t*>(s.data), s.size});
+
+    size_t first = 0;
+    while (first < iov.size()) {
+        const int count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+        ssize_t n = offset < 0 ? ::writev(fd, &iov[first], count) : ::pwritev(fd, &iov[first], count, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        if (offset >= 0) offset += n;
+
+        while (first < iov.size() && static_cast<size_t>(n) >= iov[first].iov_len) n -= iov[first++].iov_len;
+        if (n > 0) {
+            iov[first].iov_base = static_cast<uint8_t*>(iov[first].iov_base) + n;
+            iov[first].iov_len -= n;
+        }
+    }
+    return true;
+}
+
+// Cuts a regular file off where the written file ends, offset < 0 being the current position; pipes, sockets and
+// devices have nothing to truncate
+static bool truncateAfter(int fd, const std::vector<ByteSpan>& segments, int64_t offset) {
+    struct stat st;
+    if (::fstat(fd, &st) != 0) return false;
+    if (!S_ISREG(st.st_mode)) return true;
+    off_t end = offset < 0 ? ::lseek(fd, 0, SEEK_CUR) : offset;
+    if (end < 0) return false;
+    if (offset >= 0)
+        for (const ByteSpan& s : segments) end += s.size;
+    return ::ftruncate(fd, end) == 0;
+}
+#endif
+
+bool PathFileWriter::write(const PathFile& input, int fd) { return write(input, fd, -1); }
+
+bool PathFileWriter::write(const PathFile& input, int fd, int64_t offset) {
+#ifdef LEMLIB_PATH_HAS_UIO
+    try {
+        std::vector<ByteSpan> parts;
+        return segments(input, parts) && writeSegments(fd, parts, offset) && truncateAfter(fd, parts, offset);
+    } catch (std::exception& e) { return false; }
+#else
+    (void)input;
+    (void)fd;
+    (void)offset;
+    return false;
+#endif
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "pathFileSystem.hpp"
+#include "pathFileView.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// Saves a PathFile as a list of segments (the file header, then every path's header and waypoint block) written
+// with writev/pwritev, so the file is never flattened into one buffer. Paths keep their encoding and checksum
+// between saves, and only paths that changed are encoded again: every save compares the name, metadata and waypoint
+// count of a path with its cached encoding, and its waypoints and unknown parameters field by field with the copy
+// taken at the last encode. invalidate() forces a path to be encoded again regardless.
+// The editor data of the options is written as its own segment and must stay valid while the writer is used.
+class PathFileWriter {
+    private:
+        struct CachedPath {
+                std::vector<uint8_t> bytes;
+                size_t headerSize = 0;
+                uint32_t checksum = 0; // of bytes, combined into the checksum of the file
+                // what was encoded, compared with the path on every save
+                std::vector<Waypoint> waypoints;
+                std::vector<UnknownParameters> unknownParameters;
+                bool valid = false;
+        };
+
+        EncodeOptions options;
+        std::vector<uint8_t> header;
+        std::vector<CachedPath> cache;
+        size_t lastEncoded = 0;
+
+        bool prepare(const PathFile& input);
+    public:
+        explicit PathFileWriter(const EncodeOptions& options = {}) : options(options) {}
+
+        void invalidate(size_t index);
+        void invalidateAll();
+
+        // encodes whatever is stale and returns the segments of the file, which stay valid until the next call
+        bool segments(const PathFile& input, std::vector<ByteSpan>& output);
+
+        // Writes at the current position of fd. A regular file is truncated after the written file, so saving a
+        // shorter file over a longer one leaves none of the old bytes behind.
+        bool write(const PathFile& input, int fd);
+        // writes at offset without moving the position of fd, truncating a regular file like write()
+        bool write(const PathFile& input, int fd, int64_t offset);
+
+        // the number of paths encoded by the last save
+        size_t encodedPaths() const { return lastEncoded; }
+};
+
+} // namespace PathFileSystem
+} // namespace lemlib
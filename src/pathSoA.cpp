@@ -0,0 +1,165 @@
+#include <algorithm>
+#include "pathSoA.hpp"
+#include "pathFileFormat.hpp"
+#include "pathEncoder.hpp"
+#include "metadata.hpp"
+#include "unknownParameters.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+void PathSoA::resize(size_t n) {
+    x.resize(n);
+    y.resize(n);
+    speed.resize(n);
+    heading.resize(n);
+    lookahead.resize(n);
+    headingPresent.resize((n + 63) / 64);
+    lookaheadPresent.resize((n + 63) / 64);
+}
+
+void PathSoA::clear() {
+    name.clear();
+    metadata.clear();
+    unknownParameters.clear();
+    resize(0);
+}
+
+void PathSoA::push_back(const Waypoint& w) {
+    size_t idx = size();
+    resize(idx + 1);
+    x[idx] = w.x;
+    y[idx] = w.y;
+    speed[idx] = w.speed;
+    heading[idx] = w.isHeadingAvailable ? w.heading : 0;
+    lookahead[idx] = w.isLookaheadAvailable ? w.lookahead : 0;
+    setHasHeading(idx, w.isHeadingAvailable);
+    setHasLookahead(idx, w.isLookaheadAvailable);
+}
+
+void PathSoA::setHasHeading(size_t idx, bool available) {
+    uint64_t bit = (uint64_t)1 << (idx % 64);
+    headingPresent[idx / 64] = available ? headingPresent[idx / 64] | bit : headingPresent[idx / 64] & ~bit;
+}
+
+void PathSoA::setHasLookahead(size_t idx, bool available) {
+    uint64_t bit = (uint64_t)1 << (idx % 64);
+    lookaheadPresent[idx / 64] = available ? lookaheadPresent[idx / 64] | bit : lookaheadPresent[idx / 64] & ~bit;
+}
+
+Waypoint PathSoA::waypoint(size_t idx) const {
+    Waypoint w;
+    w.x = x[idx];
+    w.y = y[idx];
+    w.speed = speed[idx];
+    w.heading = heading[idx];
+    w.lookahead = lookahead[idx];
+    w.isHeadingAvailable = hasHeading(idx);
+    w.isLookaheadAvailable = hasLookahead(idx);
+    return w;
+}
+
+void toSoA(const Path& input, PathSoA& output) {
+    output.clear();
+    output.name = input.name;
+    output.metadata.assign(input.metadata.begin(), input.metadata.end());
+    output.unknownParameters.assign(input.unknownParameters.begin(), input.unknownParameters.end());
+    output.resize(input.waypoints.size());
+    for (size_t i = 0; i < input.waypoints.size(); i++) {
+        const Waypoint& w = input.waypoints[i];
+        output.x[i] = w.x;
+        output.y[i] = w.y;
+        output.speed[i] = w.speed;
+        output.heading[i] = w.isHeadingAvailable ? w.heading : 0;
+        output.lookahead[i] = w.isLookaheadAvailable ? w.lookahead : 0;
+        if (w.isHeadingAvailable) output.headingPresent[i / 64] |= (uint64_t)1 << (i % 64);
+        if (w.isLookaheadAvailable) output.lookaheadPresent[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+}
+
+void toPath(const PathSoA& input, Path& output) {
+    output.name = input.name;
+    output.metadata.assign(input.metadata.begin(), input.metadata.end());
+    output.unknownParameters.assign(input.unknownParameters.begin(), input.unknownParameters.end());
+    output.waypoints.resize(input.size());
+    for (size_t i = 0; i < input.size(); i++) output.waypoints[i] = input.waypoint(i);
+}
+
+bool decode(const PathView& view, PathSoA& output) {
+    output.clear();
+    output.name = view.name();
+    output.metadata.assign(view.metadata().data, view.metadata().data + view.metadata().size);
+
+    WaypointCursor waypoints = view.waypoints();
+    // never trust the count further than the bytes that are actually there
+    output.resize(std::min<size_t>(view.waypointCount(), waypoints.recordsThatFit()));
+
+    // chunks are multiples of 64 so every chunk fills whole bitmap words
+    const size_t chunk = 256;
+    uint8_t flags[chunk];
+    size_t done = 0;
+    uint8_t unknown = 0;
+    while (done < output.size()) {
+        WaypointColumns columns = output.columns().advanced(done);
+        columns.flag = flags;
+        size_t n = waypoints.read(columns, std::min(chunk, output.size() - done));
+        if (n == 0) break;
+
+        for (size_t i = 0; i < n; i++) {
+            const size_t idx = done + i;
+            output.headingPresent[idx / 64] |= (uint64_t)((flags[i] & format::headingFlag) != 0) << (idx % 64);
+            output.lookaheadPresent[idx / 64] |= (uint64_t)((flags[i] & format::lookaheadFlag) != 0) << (idx % 64);
+            unknown |= flags[i];
+        }
+        done += n;
+    }
+    if (waypoints.failed() || done != view.waypointCount()) return false;
+
+    // the columns have no room for unknown parameters, so the few paths that have any are walked again for them
+    if (unknown & format::unknownFlags) {
+        WaypointCursor records = view.waypoints();
+        for (uint32_t i = 0; i < done; i++) {
+            const uint8_t* record = records.position();
+            if (*record & format::unknownFlags)
+                output.unknownParameters.push_back(loadUnknownParameters(record, view.waypointEncoding(), i));
+            records.skip();
+        }
+    }
+    return true;
+}
+
+bool decode(const uint8_t* fileBuffer, const size_t fileSize, PathSoAFile& output) {
+    try {
+        PathFileView view(fileBuffer, fileSize);
+        if (!view.valid() || !view.verify()) return false;
+
+        copyFileMetadata(view.metadata(), output.metadata);
+        output.paths.reserve(output.paths.size() + view.pathCount());
+
+        PathCursor paths = view.paths();
+        PathView p;
+        while (paths.next(p)) {
+            if (!decode(p, output.paths.emplace_back())) return false;
+        }
+
+        return !paths.failed();
+    } catch (std::exception& e) { return false; }
+}
+
+size_t encodedSize(const PathSoAFile& input, const EncodeOptions& options) { return encodedFileSize(input, options); }
+
+bool encode(const PathSoAFile& input, uint8_t* fileBuffer, size_t& fileSize, const EncodeOptions& options) {
+    return encodeFile(input, fileBuffer, fileSize, options);
+}
+
+bool encode(const PathSoAFile& input, std::vector<uint8_t>& output, const EncodeOptions& options) {
+    try {
+        if (!isEncodableFile(input, options)) return false;
+        output.resize(encodedSize(input, options));
+        size_t size = output.size();
+        return encode(input, output.data(), size, options);
+    } catch (std::exception& e) { return false; }
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <vector>
+#include "pathFileSystem.hpp"
+#include "pathFileView.hpp"
+#include "waypointKernels.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+template <class T, size_t Alignment> struct AlignedAllocator {
+        using value_type = T;
+
+        template <class U> struct rebind {
+                using other = AlignedAllocator<U, Alignment>;
+        };
+
+        AlignedAllocator() = default;
+
+        template <class U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+        T* allocate(size_t n) {
+            // aligned_alloc wants the size to be a multiple of the alignment
+            size_t bytes = (n * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+            void* p = std::aligned_alloc(Alignment, bytes);
+            if (p == nullptr) throw std::bad_alloc();
+            return static_cast<T*>(p);
+        }
+
+        void deallocate(T* p, size_t) { std::free(p); }
+
+        template <class U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+
+        template <class U> bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+constexpr size_t simdAlignment = 32;
+
+template <class T> using AlignedVector = std::vector<T, AlignedAllocator<T, simdAlignment>>;
+
+// A path stored as one contiguous, SIMD aligned array per field. Presence of heading and lookahead is kept
+// in bitmaps, one bit per waypoint; absent values read as 0.
+class PathSoA {
+    public:
+        std::string name;
+        std::vector<uint8_t> metadata;
+        AlignedVector<int16_t> x;
+        AlignedVector<int16_t> y;
+        AlignedVector<int16_t> speed;
+        AlignedVector<uint16_t> heading;
+        AlignedVector<int16_t> lookahead;
+        std::vector<uint64_t> headingPresent;
+        std::vector<uint64_t> lookaheadPresent;
+        std::vector<UnknownParameters> unknownParameters; // as in Path
+
+        PathSoA() = default;
+
+        size_t size() const { return x.size(); }
+
+        void resize(size_t n);
+        void clear();
+        void push_back(const Waypoint& w);
+
+        bool hasHeading(size_t idx) const { return (headingPresent[idx / 64] >> (idx % 64)) & 1; }
+
+        bool hasLookahead(size_t idx) const { return (lookaheadPresent[idx / 64] >> (idx % 64)) & 1; }
+
+        void setHasHeading(size_t idx, bool available);
+        void setHasLookahead(size_t idx, bool available);
+
+        Waypoint waypoint(size_t idx) const;
+
+        WaypointColumns columns() { return {x.data(), y.data(), speed.data(), heading.data(), lookahead.data()}; }
+};
+
+// the columns one waypoint at a time, as the record writers shared with the Path encoder read them
+inline size_t waypointCount(const PathSoA& p) { return p.size(); }
+
+inline Waypoint waypointAt(const PathSoA& p, size_t i) { return p.waypoint(i); }
+
+void toSoA(const Path& input, PathSoA& output);
+void toPath(const PathSoA& input, Path& output);
+
+// A path file of PathSoA paths; the file metadata is kept like in PathFile, without the entries the format itself
+// uses
+class PathSoAFile {
+    public:
+        std::pmr::vector<uint8_t> metadata;
+        std::vector<PathSoA> paths;
+};
+
+// decodes straight into the columns, without going through Waypoint
+bool decode(const PathView& view, PathSoA& output);
+// appends the paths of the file to output and replaces its metadata
+bool decode(const uint8_t* fileBuffer, const size_t fileSize, PathSoAFile& output);
+
+// the exact size encode() writes
+size_t encodedSize(const PathSoAFile& input, const EncodeOptions& options = {});
+
+// fileSize is the capacity of fileBuffer on input and the encoded size on output
+bool encode(const PathSoAFile& input, uint8_t* fileBuffer, size_t& fileSize, const EncodeOptions& options = {});
+bool encode(const PathSoAFile& input, std::vector<uint8_t>& output, const EncodeOptions& options = {});
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <type_traits>
+#include "unitConversion.hpp"
+#include "waypointKernels.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define LEMLIB_PATH_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace lemlib {
+namespace PathFileSystem {
+
+template <class Int, class Real> static void toRealScalar(const Int* src, size_t count, Real* dst, int steps) {
+    const Real scale = Real(1) / Real(steps);
+    for (size_t i = 0; i < count; i++) dst[i] = src[i] * scale;
+}
+
+template <class Int, class Real> static void quantizeScalar(const Real* src, size_t count, Int* dst, int steps) {
+    for (size_t i = 0; i < count; i++) dst[i] = quantize<Int>(src[i], steps);
+}
+
+#ifdef LEMLIB_PATH_X86_KERNELS
+
+// The kernels multiply by the same constants as the scalar code and round with the vector round instructions,
+// which tie to even, so every path gives the same bits. NaN is zeroed and the rest clamped before rounding.
+
+template <class Int> __attribute__((target("sse4.1"))) static inline __m128i widenSSE41(__m128i v) {
+    if constexpr (std::is_signed_v<Int>) return _mm_cvtepi16_epi32(v);
+    else return _mm_cvtepu16_epi32(v);
+}
+
+template <class Int> __attribute__((target("sse4.1"))) static inline __m128i narrowSSE41(__m128i a, __m128i b) {
+    if constexpr (std::is_signed_v<Int>) return _mm_packs_epi32(a, b);
+    else return _mm_packus_epi32(a, b);
+}
+
+// the values at p times scale, NaN zeroed, clamped to [lo, hi] and rounded to 32-bit integers
+__attribute__((target("sse4.1"))) static inline __m128i quantizeSSE41(const float* p, __m128 scale, __m128 lo,
+                                                                     __m128 hi) {
+    __m128 s = _mm_mul_ps(_mm_loadu_ps(p), scale);
+    s = _mm_min_ps(_mm_max_ps(_mm_and_ps(s, _mm_cmpord_ps(s, s)), lo), hi);
+    return _mm_cvtps_epi32(_mm_round_ps(s, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+
+// two results in the low half
+__attribute__((target("sse4.1"))) static inline __m128i quantizeSSE41(const double* p, __m128d scale, __m128d lo,
+                                                                     __m128d hi) {
+    __m128d s = _mm_mul_pd(_mm_loadu_pd(p), scale);
+    s = _mm_min_pd(_mm_max_pd(_mm_and_pd(s, _mm_cmpord_pd(s, s)), lo), hi);
+    return _mm_cvtpd_epi32(_mm_round_pd(s, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+
+template <class Int>
+__attribute__((target("sse4.1"))) static void toFloatSSE41(const Int* src, size_t count, float* dst, int steps) {
+    const __m128 scale = _mm_set1_ps(1.0f / (float)steps);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(widenSSE41<Int>(v)), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(widenSSE41<Int>(_mm_srli_si128(v, 8))), scale));
+    }
+    toRealScalar(src + i, count - i, dst + i, steps);
+}
+
+template <class Int>
+__attribute__((target("sse4.1"))) static void toDoubleSSE41(const Int* src, size_t count, double* dst, int steps) {
+    const __m128d scale = _mm_set1_pd(1.0 / (double)steps);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i lo = widenSSE41<Int>(v), hi = widenSSE41<Int>(_mm_srli_si128(v, 8));
+        _mm_storeu_pd(dst + i, _mm_mul_pd(_mm_cvtepi32_pd(lo), scale));
+        _mm_storeu_pd(dst + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(lo, 8)), scale));
+        _mm_storeu_pd(dst + i + 4, _mm_mul_pd(_mm_cvtepi32_pd(hi), scale));
+        _mm_storeu_pd(dst + i + 6, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(hi, 8)), scale));
+    }
+    toRealScalar(src + i, count - i, dst + i, steps);
+}
+
+template <class Int>
+__attribute__((target("sse4.1"))) static void fromFloatSSE41(const float* src, size_t count, Int* dst, int steps) {
+    const __m128 scale = _mm_set1_ps((float)steps);
+    const __m128 lo = _mm_set1_ps((float)std::numeric_limits<Int>::min());
+    const __m128 hi = _mm_set1_ps((float)std::numeric_limits<Int>::max());
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i a = quantizeSSE41(src + i, scale, lo, hi), b = quantizeSSE41(src + i + 4, scale, lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), narrowSSE41<Int>(a, b));
+    }
+    quantizeScalar(src + i, count - i, dst + i, steps);
+}
+
+template <class Int>
+__attribute__((target("sse4.1"))) static void fromDoubleSSE41(const double* src, size_t count, Int* dst, int steps) {
+    const __m128d scale = _mm_set1_pd((double)steps);
+    const __m128d lo = _mm_set1_pd((double)std::numeric_limits<Int>::min());
+    const __m128d hi = _mm_set1_pd((double)std::numeric_limits<Int>::max());
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i a =
+            _mm_unpacklo_epi64(quantizeSSE41(src + i, scale, lo, hi), quantizeSSE41(src + i + 2, scale, lo, hi));
+        const __m128i b =
+            _mm_unpacklo_epi64(quantizeSSE41(src + i + 4, scale, lo, hi), quantizeSSE41(src + i + 6, scale, lo, hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), narrowSSE41<Int>(a, b));
+    }
+    quantizeScalar(src + i, count - i, dst + i, steps);
+}
+
+template <class Int> __attribute__((target("avx2"))) static inline __m256i widenAVX2(__m128i v) {
+    if constexpr (std::is_signed_v<Int>) return _mm256_cvtepi16_epi32(v);
+    else return _mm256_cvtepu16_epi32(v);
+}
+
+__attribute__((target("avx2"))) static inline __m256i quantizeAVX2(const float* p, __m256 scale, __m256 lo,
+                                                                   __m256 hi) {
+    __m256 s = _mm256_mul_ps(_mm256_loadu_ps(p), scale);
+    s = _mm256_min_ps(_mm256_max_ps(_mm256_and_ps(s, _mm256_cmp_ps(s, s, _CMP_ORD_Q)), lo), hi);
+    return _mm256_cvtps_epi32(_mm256_round_ps(s, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+
+__attribute__((target("avx2"))) static inline __m128i quantizeAVX2(const double* p, __m256d scale, __m256d lo,
+                                                                   __m256d hi) {
+    __m256d s = _mm256_mul_pd(_mm256_loadu_pd(p), scale);
+    s = _mm256_min_pd(_mm256_max_pd(_mm256_and_pd(s, _mm256_cmp_pd(s, s, _CMP_ORD_Q)), lo), hi);
+    return _mm256_cvtpd_epi32(_mm256_round_pd(s, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+
+template <class Int>
+__attribute__((target("avx2"))) static void toFloatAVX2(const Int* src, size_t count, float* dst, int steps) {
+    const __m256 scale = _mm256_set1_ps(1.0f / (float)steps);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(widenAVX2<Int>(a)), scale));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(widenAVX2<Int>(b)), scale));
+    }
+    toRealScalar(src + i, count - i, dst + i, steps);
+}
+
+template <class Int>
+__attribute__((target("avx2"))) static void toDoubleAVX2(const Int* src, size_t count, double* dst, int steps) {
+    const __m256d scale = _mm256_set1_pd(1.0 / (double)steps);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i v = widenAVX2<Int>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        _mm256_storeu_pd(dst + i, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), scale));
+        _mm256_storeu_pd(dst + i + 4, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), scale));
+    }
+    toRealScalar(src + i, count - i, dst + i, steps);
+}
+
+template <class Int>
+__attribute__((target("avx2"))) static void fromFloatAVX2(const float* src, size_t count, Int* dst, int steps) {
+    const __m256 scale = _mm256_set1_ps((float)steps);
+    const __m256 lo = _mm256_set1_ps((float)std::numeric_limits<Int>::min());
+    const __m256 hi = _mm256_set1_ps((float)std::numeric_limits<Int>::max());
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i a = quantizeAVX2(src + i, scale, lo, hi), b = quantizeAVX2(src + i + 8, scale, lo, hi);
+        // the packs work per 128-bit lane, the permute puts the 64-bit quarters back in order
+        const __m256i packed = std::is_signed_v<Int> ? _mm256_packs_epi32(a, b) : _mm256_packus_epi32(a, b);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    quantizeScalar(src + i, count - i, dst + i, steps);
+}
+
+template <class Int>
+__attribute__((target("avx2"))) static void fromDoubleAVX2(const double* src, size_t count, Int* dst, int steps) {
+    const __m256d scale = _mm256_set1_pd((double)steps);
+    const __m256d lo = _mm256_set1_pd((double)std::numeric_limits<Int>::min());
+    const __m256d hi = _mm256_set1_pd((double)std::numeric_limits<Int>::max());
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i a = quantizeAVX2(src + i, scale, lo, hi), b = quantizeAVX2(src + i + 4, scale, lo, hi);
+        const __m128i packed = std::is_signed_v<Int> ? _mm_packs_epi32(a, b) : _mm_packus_epi32(a, b);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+    quantizeScalar(src + i, count - i, dst + i, steps);
+}
+
+#endif // LEMLIB_PATH_X86_KERNELS
+
+template <class Int, class Real> static void toReal(const Int* src, size_t count, Real* dst, int steps) {
+    switch (decodeKernel()) {
+#ifdef LEMLIB_PATH_X86_KERNELS
+        case DecodeKernel::AVX2:
+            if constexpr (std::is_same_v<Real, float>) toFloatAVX2(src, count, dst, steps);
+            else toDoubleAVX2(src, count, dst, steps);
+            break;
+        case DecodeKernel::SSE41:
+            if constexpr (std::is_same_v<Real, float>) toFloatSSE41(src, count, dst, steps);
+            else toDoubleSSE41(src, count, dst, steps);
+            break;
+#endif
+        default: toRealScalar(src, count, dst, steps); break;
+    }
+}
+
+template <class Int, class Real> static void fromReal(const Real* src, size_t count, Int* dst, int steps) {
+    switch (decodeKernel()) {
+#ifdef LEMLIB_PATH_X86_KERNELS
+        case DecodeKernel::AVX2:
+            if constexpr (std::is_same_v<Real, float>) fromFloatAVX2(src, count, dst, steps);
+            else fromDoubleAVX2(src, count, dst, steps);
+            break;
+        case DecodeKernel::SSE41:
+            if constexpr (std::is_same_v<Real, float>) fromFloatSSE41(src, count, dst, steps);
+            else fromDoubleSSE41(src, count, dst, steps);
+            break;
+#endif
+        default: quantizeScalar(src, count, dst, steps); break;
+    }
+}
+
+// waypoints per gather buffer, small enough for the stack and long enough for the kernels
+constexpr size_t gatherSize = 256;
+
+template <class Int, class Real>
+static void toReal(const Waypoint* src, size_t count, Int Waypoint::*field, Real* dst, int steps) {
+    Int buffer[gatherSize];
+    for (size_t done = 0; done < count; done += gatherSize) {
+        const size_t n = std::min(gatherSize, count - done);
+        for (size_t i = 0; i < n; i++) buffer[i] = src[done + i].*field;
+        toReal(buffer, n, dst + done, steps);
+    }
+}
+
+template <class Int, class Real>
+static void fromReal(const Real* src, size_t count, Waypoint* dst, Int Waypoint::*field, int steps) {
+    Int buffer[gatherSize];
+    for (size_t done = 0; done < count; done += gatherSize) {
+        const size_t n = std::min(gatherSize, count - done);
+        fromReal(src + done, n, buffer, steps);
+        for (size_t i = 0; i < n; i++) dst[done + i].*field = buffer[i];
+    }
+}
+
+void toMetres(const int16_t* src, size_t count, float* dst) { toReal(src, count, dst, stepsPerMetre); }
+
+void toMetres(const int16_t* src, size_t count, double* dst) { toReal(src, count, dst, stepsPerMetre); }
+
+void toMetresPerSecond(const int16_t* src, size_t count, float* dst) {
+    toReal(src, count, dst, stepsPerMetrePerSecond);
+}
+
+void toMetresPerSecond(const int16_t* src, size_t count, double* dst) {
+    toReal(src, count, dst, stepsPerMetrePerSecond);
+}
+
+void toRadians(const uint16_t* src, size_t count, float* dst) { toReal(src, count, dst, stepsPerRadian); }
+
+void toRadians(const uint16_t* src, size_t count, double* dst) { toReal(src, count, dst, stepsPerRadian); }
+
+void fromMetres(const float* src, size_t count, int16_t* dst) { fromReal(src, count, dst, stepsPerMetre); }
+
+void fromMetres(const double* src, size_t count, int16_t* dst) { fromReal(src, count, dst, stepsPerMetre); }
+
+void fromMetresPerSecond(const float* src, size_t count, int16_t* dst) {
+    fromReal(src, count, dst, stepsPerMetrePerSecond);
+}
+
+void fromMetresPerSecond(const double* src, size_t count, int16_t* dst) {
+    fromReal(src, count, dst, stepsPerMetrePerSecond);
+}
+
+void fromRadians(const float* src, size_t count, uint16_t* dst) { fromReal(src, count, dst, stepsPerRadian); }
+
+void fromRadians(const double* src, size_t count, uint16_t* dst) { fromReal(src, count, dst, stepsPerRadian); }
+
+void toMetres(const Waypoint* src, size_t count, int16_t Waypoint::*field, float* dst) {
+    toReal(src, count, field, dst, stepsPerMetre);
+}
+
+void toMetres(const Waypoint* src, size_t count, int16_t Waypoint::*field, double* dst) {
+    toReal(src, count, field, dst, stepsPerMetre);
+}
+
+void toMetresPerSecond(const Waypoint* src, size_t count, float* dst) {
+    toReal(src, count, &Waypoint::speed, dst, stepsPerMetrePerSecond);
+}
+
+void toMetresPerSecond(const Waypoint* src, size_t count, double* dst) {
+    toReal(src, count, &Waypoint::speed, dst, stepsPerMetrePerSecond);
+}
+
+void toRadians(const Waypoint* src, size_t count, float* dst) {
+    toReal(src, count, &Waypoint::heading, dst, stepsPerRadian);
+}
+
+void toRadians(const Waypoint* src, size_t count, double* dst) {
+    toReal(src, count, &Waypoint::heading, dst, stepsPerRadian);
+}
+
+void fromMetres(const float* src, size_t count, Waypoint* dst, int16_t Waypoint::*field) {
+    fromReal(src, count, dst, field, stepsPerMetre);
+}
+
+void fromMetres(const double* src, size_t count, Waypoint* dst, int16_t Waypoint::*field) {
+    fromReal(src, count, dst, field, stepsPerMetre);
+}
+
+void fromMetresPerSecond(const float* src, size_t count, Waypoint* dst) {
+    fromReal(src, count, dst, &Waypoint::speed, stepsPerMetrePerSecond);
+}
+
+void fromMetresPerSecond(const double* src, size_t count, Waypoint* dst) {
+    fromReal(src, count, dst, &Waypoint::speed, stepsPerMetrePerSecond);
+}
+
+void fromRadians(const float* src, size_t count, Waypoint* dst) {
+    fromReal(src, count, dst, &Waypoint::heading, stepsPerRadian);
+}
+
+void fromRadians(const double* src, size_t count, Waypoint* dst) {
+    fromReal(src, count, dst, &Waypoint::heading, stepsPerRadian);
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
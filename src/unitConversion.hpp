@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include "pathFileSystem.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// Steps of the waypoint fields per SI unit: x, y and lookahead are 0.5 mm, speed is 1 mm/s, heading is 0.0001 rad
+constexpr int stepsPerMetre = 2000;
+constexpr int stepsPerMetrePerSecond = 1000;
+constexpr int stepsPerRadian = 10000;
+
+// Rounds to the nearest integer, ties to even, like the vector kernels do. Only for values within 32-bit range.
+template <class T> constexpr T roundHalfEven(T value) {
+    const T truncated = (T)(int32_t)value;
+    const T fraction = value - truncated;
+    const bool odd = ((int32_t)truncated & 1) != 0;
+    if (fraction > T(0.5) || (fraction == T(0.5) && odd)) return truncated + 1;
+    if (fraction < T(-0.5) || (fraction == T(-0.5) && odd)) return truncated - 1;
+    return truncated;
+}
+
+// value * steps rounded half to even and saturated to Int; NaN is 0
+template <class Int, class T> constexpr Int quantize(T value, int steps) {
+    const T scaled = value * T(steps);
+    if (scaled != scaled) return 0;
+    if (scaled <= T(std::numeric_limits<Int>::min())) return std::numeric_limits<Int>::min();
+    if (scaled >= T(std::numeric_limits<Int>::max())) return std::numeric_limits<Int>::max();
+    return (Int)roundHalfEven(scaled);
+}
+
+template <class T = double> constexpr T toMetres(int16_t value) { return value * (T(1) / T(stepsPerMetre)); }
+
+template <class T = double> constexpr T toMetresPerSecond(int16_t value) {
+    return value * (T(1) / T(stepsPerMetrePerSecond));
+}
+
+template <class T = double> constexpr T toRadians(uint16_t value) { return value * (T(1) / T(stepsPerRadian)); }
+
+template <class T> constexpr int16_t fromMetres(T metres) { return quantize<int16_t>(metres, stepsPerMetre); }
+
+template <class T> constexpr int16_t fromMetresPerSecond(T speed) {
+    return quantize<int16_t>(speed, stepsPerMetrePerSecond);
+}
+
+// headings are not wrapped to [0, 2pi), they saturate like the other fields
+template <class T> constexpr uint16_t fromRadians(T heading) { return quantize<uint16_t>(heading, stepsPerRadian); }
+
+// Batch conversions of waypoint columns, e.g. those of PathSoA or PathColumns, with the same results as the
+// single-value helpers above. They use the vector instructions of decodeKernel() and the scalar loop otherwise.
+void toMetres(const int16_t* src, size_t count, float* dst);
+void toMetres(const int16_t* src, size_t count, double* dst);
+void toMetresPerSecond(const int16_t* src, size_t count, float* dst);
+void toMetresPerSecond(const int16_t* src, size_t count, double* dst);
+void toRadians(const uint16_t* src, size_t count, float* dst);
+void toRadians(const uint16_t* src, size_t count, double* dst);
+
+void fromMetres(const float* src, size_t count, int16_t* dst);
+void fromMetres(const double* src, size_t count, int16_t* dst);
+void fromMetresPerSecond(const float* src, size_t count, int16_t* dst);
+void fromMetresPerSecond(const double* src, size_t count, int16_t* dst);
+void fromRadians(const float* src, size_t count, uint16_t* dst);
+void fromRadians(const double* src, size_t count, uint16_t* dst);
+
+// The same for a field of Waypoints, e.g. those of a Path, without copying them into columns first: field is
+// &Waypoint::x, &Waypoint::y or &Waypoint::lookahead for metres. The fields are gathered into a small buffer
+// and go through the same kernels; the availability flags are neither read nor written.
+void toMetres(const Waypoint* src, size_t count, int16_t Waypoint::*field, float* dst);
+void toMetres(const Waypoint* src, size_t count, int16_t Waypoint::*field, double* dst);
+void toMetresPerSecond(const Waypoint* src, size_t count, float* dst);
+void toMetresPerSecond(const Waypoint* src, size_t count, double* dst);
+void toRadians(const Waypoint* src, size_t count, float* dst);
+void toRadians(const Waypoint* src, size_t count, double* dst);
+
+// writes only the given field of each waypoint
+void fromMetres(const float* src, size_t count, Waypoint* dst, int16_t Waypoint::*field);
+void fromMetres(const double* src, size_t count, Waypoint* dst, int16_t Waypoint::*field);
+void fromMetresPerSecond(const float* src, size_t count, Waypoint* dst);
+void fromMetresPerSecond(const double* src, size_t count, Waypoint* dst);
+void fromRadians(const float* src, size_t count, Waypoint* dst);
+void fromRadians(const double* src, size_t count, Waypoint* dst);
+
+} // namespace PathFileSystem
+} // namespace lemlib
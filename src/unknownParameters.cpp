@@ -0,0 +1,62 @@
+#include "unknownParameters.hpp"
+#include "pathFileFormat.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+UnknownParameters loadUnknownParameters(const uint8_t* record, WaypointEncoding encoding, uint32_t waypoint) {
+    UnknownParameters output = {};
+    output.waypoint = waypoint;
+    output.flags = record[0] & format::unknownFlags;
+    const size_t known = format::fieldCount(record[0] & ~format::unknownFlags);
+    const size_t count = format::parameterCount(output.flags);
+
+    if (encoding == WaypointEncoding::Plain) {
+        const format::RecordLayout& layout = format::recordLayout(record[0]);
+        for (size_t bit = 0, i = 0; bit < 6; bit++) {
+            if (layout.unknown[bit] != 0) output.values[i++] = format::load<uint16_t>(record + layout.unknown[bit]);
+        }
+        return output;
+    }
+
+    // the record was decoded before, but a malformed field still stops the walk and leaves the rest at 0
+    const uint8_t* p = record + 1;
+    for (size_t i = 0; i < known + count; i++) {
+        uint16_t value = 0;
+        p = format::loadVarint(p, p + format::maxVarintSize, value);
+        if (p == nullptr) break;
+        if (i >= known) output.values[i - known] = (uint16_t)format::unzigzag(value);
+    }
+    return output;
+}
+
+size_t unknownParametersSize(const UnknownParameters& parameters, WaypointEncoding encoding) {
+    const size_t count = format::parameterCount(parameters.flags);
+    if (encoding == WaypointEncoding::Plain) return 2 * count;
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) size += format::varintSize(format::zigzag((int16_t)parameters.values[i]));
+    return size;
+}
+
+uint8_t* storeUnknownParameters(uint8_t* record, uint8_t* dst, const UnknownParameters& parameters,
+                                WaypointEncoding encoding) {
+    record[0] |= parameters.flags;
+    const size_t count = format::parameterCount(parameters.flags);
+    for (size_t i = 0; i < count; i++) {
+        const uint16_t value = parameters.values[i];
+        dst = encoding == WaypointEncoding::Plain ? format::store(dst, value)
+                                                  : format::storeVarint(dst, format::zigzag((int16_t)value));
+    }
+    return dst;
+}
+
+bool isValidUnknownParameters(const UnknownParameters* table, size_t size, size_t waypointCount) {
+    for (size_t i = 0; i < size; i++) {
+        if (table[i].flags == 0 || (table[i].flags & ~format::unknownFlags) != 0) return false;
+        if (table[i].waypoint >= waypointCount || (i > 0 && table[i].waypoint <= table[i - 1].waypoint)) return false;
+    }
+    return true;
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "pathFileSystem.hpp"
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// Reads the unknown parameters of a complete record, one whose flag byte has unknownFlags bits set. They follow
+// the known fields, as 16-bit values in the plain layout and as zigzag varints in the delta layout.
+UnknownParameters loadUnknownParameters(const uint8_t* record, WaypointEncoding encoding, uint32_t waypoint);
+
+// the bytes the parameters add to their record
+size_t unknownParametersSize(const UnknownParameters& parameters, WaypointEncoding encoding);
+// appends the parameters to a record whose known fields end at dst, and sets their bits in its flag byte
+uint8_t* storeUnknownParameters(uint8_t* record, uint8_t* dst, const UnknownParameters& parameters,
+                                WaypointEncoding encoding);
+
+// true if the table is sorted, has at most one entry per waypoint and only unknown, non-empty flags
+bool isValidUnknownParameters(const UnknownParameters* table, size_t size, size_t waypointCount);
+
+// Walks a side table alongside the waypoints of a path, which are visited in order
+class UnknownParametersCursor {
+    private:
+        const UnknownParameters* ptr;
+        const UnknownParameters* end;
+    public:
+        UnknownParametersCursor(const UnknownParameters* table, size_t size) : ptr(table), end(table + size) {}
+
+        // the entry of the waypoint, or nullptr if it has none
+        const UnknownParameters* at(size_t waypoint) {
+            if (ptr == end || ptr->waypoint != waypoint) return nullptr;
+            return ptr++;
+        }
+};
+
+} // namespace PathFileSystem
+} // namespace lemlib
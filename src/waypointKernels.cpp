@@ -0,0 +1,202 @@
+#include <atomic>
+#include <cstring>
+#include <utility>
+#include "waypointKernels.hpp"
+#include "pathFileFormat.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define LEMLIB_PATH_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// the mask of the columns the kernels are compiled for, the flag column is filled by decodeRun() itself
+constexpr unsigned valueFields = WaypointX | WaypointY | WaypointSpeed | WaypointHeading | WaypointLookahead;
+
+template <unsigned Fields>
+static void decodeRunScalar(const uint8_t* src, const uint8_t*, uint8_t flag, size_t count,
+                            const WaypointColumns& output) {
+    const format::RecordLayout& layout = format::recordLayout(flag);
+
+    for (size_t i = 0; i < count; i++, src += layout.size) {
+        if constexpr ((Fields & WaypointX) != 0) output.x[i] = format::load<int16_t>(src + 1);
+        if constexpr ((Fields & WaypointY) != 0) output.y[i] = format::load<int16_t>(src + 3);
+        if constexpr ((Fields & WaypointSpeed) != 0) output.speed[i] = format::load<int16_t>(src + 5);
+        if constexpr ((Fields & WaypointHeading) != 0)
+            output.heading[i] = layout.heading ? format::load<uint16_t>(src + layout.heading) : 0;
+        if constexpr ((Fields & WaypointLookahead) != 0)
+            output.lookahead[i] = layout.lookahead ? format::load<int16_t>(src + layout.lookahead) : 0;
+    }
+}
+
+#ifdef LEMLIB_PATH_X86_KERNELS
+
+// pshufb control that moves x, y, speed, heading and lookahead of one record into 16-bit lanes 0 to 4
+static void shuffleControl(uint8_t flag, int8_t control[16]) {
+    const int8_t zero = (int8_t)0x80;
+    const format::RecordLayout& layout = format::recordLayout(flag);
+
+    for (int i = 0; i < 16; i++) control[i] = zero;
+    for (int i = 0; i < 6; i++) control[i] = 1 + i;
+    if (layout.heading) control[6] = layout.heading, control[7] = layout.heading + 1;
+    if (layout.lookahead) control[8] = layout.lookahead, control[9] = layout.lookahead + 1;
+}
+
+// stores one field of the records from i on, if Field is one of the columns wanted
+template <unsigned Fields, unsigned Field, class T>
+static inline void storeColumn(T* column, size_t i, __m128i values) {
+    if constexpr ((Fields & Field) != 0) _mm_storeu_si128(reinterpret_cast<__m128i*>(column + i), values);
+}
+
+template <unsigned Fields, unsigned Field, class T>
+__attribute__((target("avx2"))) static inline void storeColumn(T* column, size_t i, __m256i values) {
+    if constexpr ((Fields & Field) != 0) _mm256_storeu_si256(reinterpret_cast<__m256i*>(column + i), values);
+}
+
+template <unsigned Fields>
+__attribute__((target("sse4.1"))) static void decodeRunSSE41(const uint8_t* src, const uint8_t* end, uint8_t flag,
+                                                             size_t count, const WaypointColumns& output) {
+    const size_t stride = format::recordSize(flag);
+    int8_t control[16];
+    shuffleControl(flag, control);
+    const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control));
+
+    size_t i = 0;
+    // every record is loaded as a full 16 bytes, so the last one of a block must leave that much room
+    for (; i + 8 <= count && src + (i + 7) * stride + 16 <= end; i += 8) {
+        const uint8_t* block = src + i * stride;
+        __m128i r[8];
+        for (int k = 0; k < 8; k++)
+            r[k] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + k * stride)), mask);
+
+        // 8x8 transpose of 16-bit lanes, rows are records and columns are fields
+        __m128i u0 = _mm_unpacklo_epi16(r[0], r[1]), u1 = _mm_unpackhi_epi16(r[0], r[1]);
+        __m128i u2 = _mm_unpacklo_epi16(r[2], r[3]), u3 = _mm_unpackhi_epi16(r[2], r[3]);
+        __m128i u4 = _mm_unpacklo_epi16(r[4], r[5]), u5 = _mm_unpackhi_epi16(r[4], r[5]);
+        __m128i u6 = _mm_unpacklo_epi16(r[6], r[7]), u7 = _mm_unpackhi_epi16(r[6], r[7]);
+        __m128i v0 = _mm_unpacklo_epi32(u0, u2), v1 = _mm_unpackhi_epi32(u0, u2), v2 = _mm_unpacklo_epi32(u1, u3);
+        __m128i v4 = _mm_unpacklo_epi32(u4, u6), v5 = _mm_unpackhi_epi32(u4, u6), v6 = _mm_unpacklo_epi32(u5, u7);
+
+        storeColumn<Fields, WaypointX>(output.x, i, _mm_unpacklo_epi64(v0, v4));
+        storeColumn<Fields, WaypointY>(output.y, i, _mm_unpackhi_epi64(v0, v4));
+        storeColumn<Fields, WaypointSpeed>(output.speed, i, _mm_unpacklo_epi64(v1, v5));
+        storeColumn<Fields, WaypointHeading>(output.heading, i, _mm_unpackhi_epi64(v1, v5));
+        storeColumn<Fields, WaypointLookahead>(output.lookahead, i, _mm_unpacklo_epi64(v2, v6));
+    }
+
+    decodeRunScalar<Fields>(src + i * stride, end, flag, count - i, output.advanced(i));
+}
+
+template <unsigned Fields>
+__attribute__((target("avx2"))) static void decodeRunAVX2(const uint8_t* src, const uint8_t* end, uint8_t flag,
+                                                          size_t count, const WaypointColumns& output) {
+    const size_t stride = format::recordSize(flag);
+    int8_t control[16];
+    shuffleControl(flag, control);
+    const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(control)));
+
+    size_t i = 0;
+    for (; i + 16 <= count && src + (i + 15) * stride + 16 <= end; i += 16) {
+        const uint8_t* block = src + i * stride;
+        // record k goes to the low lane and record k + 8 to the high lane, so the in-lane transpose below
+        // leaves records 0 to 15 of each field contiguous
+        __m256i r[8];
+        for (int k = 0; k < 8; k++) {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + k * stride));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + (k + 8) * stride));
+            r[k] = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), mask);
+        }
+
+        __m256i u0 = _mm256_unpacklo_epi16(r[0], r[1]), u1 = _mm256_unpackhi_epi16(r[0], r[1]);
+        __m256i u2 = _mm256_unpacklo_epi16(r[2], r[3]), u3 = _mm256_unpackhi_epi16(r[2], r[3]);
+        __m256i u4 = _mm256_unpacklo_epi16(r[4], r[5]), u5 = _mm256_unpackhi_epi16(r[4], r[5]);
+        __m256i u6 = _mm256_unpacklo_epi16(r[6], r[7]), u7 = _mm256_unpackhi_epi16(r[6], r[7]);
+        __m256i v0 = _mm256_unpacklo_epi32(u0, u2), v1 = _mm256_unpackhi_epi32(u0, u2);
+        __m256i v2 = _mm256_unpacklo_epi32(u1, u3);
+        __m256i v4 = _mm256_unpacklo_epi32(u4, u6), v5 = _mm256_unpackhi_epi32(u4, u6);
+        __m256i v6 = _mm256_unpacklo_epi32(u5, u7);
+
+        storeColumn<Fields, WaypointX>(output.x, i, _mm256_unpacklo_epi64(v0, v4));
+        storeColumn<Fields, WaypointY>(output.y, i, _mm256_unpackhi_epi64(v0, v4));
+        storeColumn<Fields, WaypointSpeed>(output.speed, i, _mm256_unpacklo_epi64(v1, v5));
+        storeColumn<Fields, WaypointHeading>(output.heading, i, _mm256_unpackhi_epi64(v1, v5));
+        storeColumn<Fields, WaypointLookahead>(output.lookahead, i, _mm256_unpacklo_epi64(v2, v6));
+    }
+
+    // staying in VEX-encoded code here avoids an SSE transition penalty on the tail
+    decodeRunScalar<Fields>(src + i * stride, end, flag, count - i, output.advanced(i));
+}
+
+#endif // LEMLIB_PATH_X86_KERNELS
+
+using RunKernel = void (*)(const uint8_t*, const uint8_t*, uint8_t, size_t, const WaypointColumns&);
+
+// every kernel instantiated for each mask of the value columns, indexed by the mask
+template <unsigned... Fields> struct RunKernels {
+        static constexpr RunKernel scalar[] = {&decodeRunScalar<Fields>...};
+#ifdef LEMLIB_PATH_X86_KERNELS
+        static constexpr RunKernel sse41[] = {&decodeRunSSE41<Fields>...};
+        static constexpr RunKernel avx2[] = {&decodeRunAVX2<Fields>...};
+#endif
+};
+
+template <unsigned... Fields> static RunKernels<Fields...> runKernels(std::integer_sequence<unsigned, Fields...>);
+
+using Kernels = decltype(runKernels(std::make_integer_sequence<unsigned, valueFields + 1>()));
+
+bool isDecodeKernelSupported(DecodeKernel kernel) {
+    switch (kernel) {
+        case DecodeKernel::Scalar: return true;
+#ifdef LEMLIB_PATH_X86_KERNELS
+        case DecodeKernel::SSE41: return __builtin_cpu_supports("sse4.1");
+        case DecodeKernel::AVX2: return __builtin_cpu_supports("avx2");
+#endif
+        default: return false;
+    }
+}
+
+static DecodeKernel detectDecodeKernel() {
+    if (isDecodeKernelSupported(DecodeKernel::AVX2)) return DecodeKernel::AVX2;
+    if (isDecodeKernelSupported(DecodeKernel::SSE41)) return DecodeKernel::SSE41;
+    return DecodeKernel::Scalar;
+}
+
+static std::atomic<DecodeKernel>& activeKernel() {
+    static std::atomic<DecodeKernel> kernel(detectDecodeKernel());
+    return kernel;
+}
+
+DecodeKernel decodeKernel() { return activeKernel().load(std::memory_order_relaxed); }
+
+bool setDecodeKernel(DecodeKernel kernel) {
+    if (!isDecodeKernelSupported(kernel)) return false;
+    activeKernel().store(kernel, std::memory_order_relaxed);
+    return true;
+}
+
+const char* decodeKernelName(DecodeKernel kernel) {
+    switch (kernel) {
+        case DecodeKernel::SSE41: return "sse4.1";
+        case DecodeKernel::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+void decodeRun(const uint8_t* src, const uint8_t* end, uint8_t flag, size_t count, const WaypointColumns& output,
+               unsigned fields) {
+    if ((fields & WaypointFlag) != 0) memset(output.flag, flag, count);
+
+    const unsigned values = fields & valueFields;
+    switch (decodeKernel()) {
+#ifdef LEMLIB_PATH_X86_KERNELS
+        case DecodeKernel::AVX2: Kernels::avx2[values](src, end, flag, count, output); break;
+        case DecodeKernel::SSE41: Kernels::sse41[values](src, end, flag, count, output); break;
+#endif
+        default: Kernels::scalar[values](src, end, flag, count, output); break;
+    }
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
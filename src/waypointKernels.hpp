@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace lemlib {
+namespace PathFileSystem {
+
+// Fields of a waypoint, combined into the masks of PathColumns and of the columns to decode
+enum WaypointField : unsigned {
+    WaypointX = 0x01,
+    WaypointY = 0x02,
+    WaypointSpeed = 0x04,
+    WaypointHeading = 0x08,
+    WaypointLookahead = 0x10,
+    WaypointFlag = 0x20
+};
+
+// Destination columns for decoded waypoints. Absent heading or lookahead values are written as 0, and columns left
+// nullptr are not written at all.
+struct WaypointColumns {
+        int16_t* x;
+        int16_t* y;
+        int16_t* speed;
+        uint16_t* heading;
+        int16_t* lookahead;
+        uint8_t* flag = nullptr; // optional
+
+        WaypointColumns advanced(size_t n) const {
+            return {x != nullptr ? x + n : nullptr,
+                    y != nullptr ? y + n : nullptr,
+                    speed != nullptr ? speed + n : nullptr,
+                    heading != nullptr ? heading + n : nullptr,
+                    lookahead != nullptr ? lookahead + n : nullptr,
+                    flag != nullptr ? flag + n : nullptr};
+        }
+};
+
+// the WaypointField mask of the columns that are not nullptr
+inline unsigned columnFields(const WaypointColumns& c) {
+    return (c.x != nullptr ? WaypointX : 0u) | (c.y != nullptr ? WaypointY : 0u) |
+           (c.speed != nullptr ? WaypointSpeed : 0u) | (c.heading != nullptr ? WaypointHeading : 0u) |
+           (c.lookahead != nullptr ? WaypointLookahead : 0u) | (c.flag != nullptr ? WaypointFlag : 0u);
+}
+
+enum class DecodeKernel { Scalar, SSE41, AVX2 };
+
+// the kernel picked for this CPU on first use, unless overridden
+DecodeKernel decodeKernel();
+// false if the CPU does not support the kernel
+bool setDecodeKernel(DecodeKernel kernel);
+bool isDecodeKernelSupported(DecodeKernel kernel);
+const char* decodeKernelName(DecodeKernel kernel);
+
+// Decodes count consecutive records that all carry the same flag into the columns in fields, a WaypointField mask;
+// the others are not written and may be nullptr. Each kernel is compiled once per mask, so the stores of a run do not
+// test the columns. The records must lie within [src, end); the kernels never read past end.
+void decodeRun(const uint8_t* src, const uint8_t* end, uint8_t flag, size_t count, const WaypointColumns& output,
+               unsigned fields);
+
+inline void decodeRun(const uint8_t* src, const uint8_t* end, uint8_t flag, size_t count,
+                      const WaypointColumns& output) {
+    decodeRun(src, end, flag, count, output, columnFields(output));
+}
+
+} // namespace PathFileSystem
+} // namespace lemlib
@@ -0,0 +1,27 @@
+#include <cstdlib>
+#include <vector>
+#include "pathFileSystem.hpp"
+#include "pathFileView.hpp"
+#include "pathFileValidator.hpp"
+
+using namespace lemlib::PathFileSystem;
+
+// validate() and decode() must agree on every input, and whatever decodes must encode to a valid file again
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    const ValidationResult result = validate(data, size);
+    if (!result.ok() && result.offset > size) abort();
+
+    PathFile decoded;
+    if (decode(data, size, decoded) != result.ok()) abort();
+    if (!result.ok()) return 0;
+
+    const PathFileView view(data, size);
+    EncodeOptions options;
+    options.waypoints = view.encoding();
+    options.header = view.hasHeader();
+    options.editorData = view.editorData();
+    std::vector<uint8_t> encoded;
+    // metadata that is not a list of entries may not be writable, which is fine
+    if (encode(decoded, encoded, options) && !validate(encoded.data(), encoded.size()).ok()) abort();
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include "byteBuffer.hpp"
+#include "byteBufferBuilder.hpp"
 
 using namespace lemlib;
 
@@ -349,16 +350,19 @@ static void test(int level, ByteBuffer& b) {
 
     // Heterogeneous accessors
 
-    // b.order(ByteOrder.BIG_ENDIAN);
+    b.order(ByteOrder::BigEndian);
     for (int i = 0; i <= 9; i++) {
         b.position(i);
         testHet(level + 1, b);
     }
-    // b.order(ByteOrder.LITTLE_ENDIAN);
+    b.order(ByteOrder::LittleEndian);
     b.position(3);
     testHet(level + 1, b);
 
     testHetAbs(level + 1, b);
+    b.order(ByteOrder::BigEndian);
+    testHetAbs(level + 1, b);
+    b.order(ByteBuffer::nativeOrder());
 }
 
 TEST_CASE("testViaAllocate") {
@@ -432,4 +436,251 @@ TEST_CASE("testCustom") {
 
     REQUIRE(std::string("hello ") == b.getNTBS());
     REQUIRE(earth == b.getNTBS());
-}
\ No newline at end of file
+}
+
+TEST_CASE("testOrderAndArrays") {
+    ByteBuffer b = ByteBuffer::allocate(64);
+    REQUIRE(b.order() == ByteBuffer::nativeOrder());
+
+    b.order(ByteOrder::BigEndian).put((uint16_t)0x0102).put((uint32_t)0x03040506);
+    b.order(ByteOrder::LittleEndian).put((uint16_t)0x0102);
+    REQUIRE(b[0] == 0x01);
+    REQUIRE(b[1] == 0x02);
+    REQUIRE(b[2] == 0x03);
+    REQUIRE(b[5] == 0x06);
+    REQUIRE(b[6] == 0x02);
+    REQUIRE(b[7] == 0x01);
+
+    b.flip();
+    REQUIRE(b.order(ByteOrder::BigEndian).get<uint16_t>() == 0x0102);
+    REQUIRE(b.get<uint32_t>() == 0x03040506);
+    REQUIRE(b.order(ByteOrder::LittleEndian).get<uint16_t>() == 0x0102);
+
+    // absolute accessors leave the position alone
+    b.clear();
+    b.put(4, (int16_t)-2);
+    REQUIRE(b.position() == 0);
+    REQUIRE(b.get<int16_t>(4) == -2);
+    REQUIRE(b.position() == 0);
+    REQUIRE_THROWS_AS(b.put(63, (int16_t)1), std::out_of_range);
+
+    for (ByteOrder order : {ByteOrder::LittleEndian, ByteOrder::BigEndian}) {
+        int16_t values[10] = {1, -2, 3, -4, 5, -6, 7, -8, 9, 0x1234};
+        int16_t read[10] = {};
+        b.clear().order(order);
+        b.putArray(values, 10);
+        REQUIRE(b.position() == 20);
+        b.flip();
+        REQUIRE(b.get<int16_t>(18) == 0x1234);
+        b.getArray(read, 10);
+        REQUIRE(memcmp(values, read, sizeof(values)) == 0);
+        REQUIRE(b.position() == 20);
+    }
+
+    b.clear();
+    b.position(60);
+    int32_t big[2] = {1, 2};
+    REQUIRE_THROWS_AS(b.putArray(big, 2), std::overflow_error);
+    REQUIRE_THROWS_AS(b.getArray(big, 2), std::underflow_error);
+    REQUIRE(b.position() == 60);
+}
+
+TEST_CASE("benchmark ByteBuffer") {
+    const size_t count = 512 * 1024;
+    ByteBuffer b = ByteBuffer::allocate(count * sizeof(int16_t));
+    std::vector<int16_t> values(count);
+    for (size_t i = 0; i < count; i++) values[i] = (int16_t)(i * 31);
+
+    BENCHMARK("put<int16_t>") {
+        b.clear();
+        for (size_t i = 0; i < count; i++) b.put(values[i]);
+        return b.position();
+    };
+
+    BENCHMARK("get<int16_t>") {
+        b.rewind();
+        int sum = 0;
+        for (size_t i = 0; i < count; i++) sum += b.get<int16_t>();
+        return sum;
+    };
+
+    BENCHMARK("get<int16_t>(index)") {
+        int sum = 0;
+        for (size_t i = 0; i < count; i++) sum += b.get<int16_t>(i * sizeof(int16_t));
+        return sum;
+    };
+
+    BENCHMARK("putArray<int16_t>") {
+        b.clear();
+        b.putArray(values.data(), count);
+        return b.position();
+    };
+
+    BENCHMARK("getArray<int16_t>") {
+        b.rewind();
+        b.getArray(values.data(), count);
+        return values[count - 1];
+    };
+
+    b.order(ByteOrder::BigEndian);
+    BENCHMARK("get<int16_t>, swapped order") {
+        b.rewind();
+        int sum = 0;
+        for (size_t i = 0; i < count; i++) sum += b.get<int16_t>();
+        return sum;
+    };
+
+    BENCHMARK("getArray<int16_t>, swapped order") {
+        b.rewind();
+        b.getArray(values.data(), count);
+        return values[count - 1];
+    };
+}
+
+TEST_CASE("testSliceDuplicateAndMove") {
+    ByteBuffer b = ByteBuffer::allocate(64);
+    relPut(b);
+
+    b.position(10).limit(30);
+    ByteBuffer s = b.slice();
+    ck(s, s.capacity(), 20);
+    ck(s, s.position(), 0);
+    ck(s, s.limit(), 20);
+    ck(s, s.arrayOffset(), 10);
+    REQUIRE(s.array() == b.array());
+    REQUIRE(s.get(0) == b.get(10));
+    REQUIRE(s[19] == b[29]);
+    REQUIRE(s.get<int16_t>(4) == b.get<int16_t>(14));
+    REQUIRE_THROWS_AS(s.get(20), std::out_of_range);
+
+    // writes through the slice are visible in the original and the other way round
+    s.put(0, (char)42);
+    REQUIRE(b.get(10) == 42);
+    b.put(11, (char)43);
+    REQUIRE(s.get(1) == 43);
+
+    // a slice of a slice keeps adding up the offset
+    s.position(5);
+    ByteBuffer ss = s.slice();
+    ck(ss, ss.arrayOffset(), 15);
+    REQUIRE(ss.get(0) == b.get(15));
+
+    ByteBuffer d = b.duplicate();
+    ck(d, d.position(), b.position());
+    ck(d, d.limit(), b.limit());
+    d.position(0).limit(64);
+    ck(b, b.position(), 10);
+    ck(b, b.limit(), 30);
+    d.put((char)7);
+    REQUIRE(b.get(0) == 7);
+
+    // the storage lives as long as any view of it
+    {
+        ByteBuffer owner = ByteBuffer::allocate(16);
+        owner.put((int32_t)0x11223344);
+        owner.flip();
+        s = owner.slice();
+    }
+    REQUIRE(s.get<int32_t>() == 0x11223344);
+
+    // compact works on the slice's own range
+    ByteBuffer c = b.duplicate();
+    c.clear();
+    relPut(c);
+    ByteBuffer cs = c.position(8).slice();
+    cs.position(2);
+    cs.compact();
+    REQUIRE(c.get(8) == (char)ic(10));
+
+    ByteBuffer moved = std::move(d);
+    ck(moved, moved.capacity(), 64);
+    ck(d, d.capacity(), 0);
+    REQUIRE(moved.array() == b.array());
+
+    ByteBuffer assigned = ByteBuffer::allocate(4);
+    assigned = std::move(moved);
+    REQUIRE(assigned.array() == b.array());
+
+    // copies stay deep
+    ByteBuffer copy = ByteBuffer::allocate(4);
+    copy = s;
+    REQUIRE(copy.array() != s.array());
+    REQUIRE(copy == s);
+    ck(copy, copy.arrayOffset(), 0);
+
+    // wrapped arrays are not owned, their views just alias them
+    char* raw = new char[8]();
+    {
+        ByteBuffer w = ByteBuffer::wrap(8, raw);
+        ByteBuffer ws = w.slice();
+        ws.put(3, (char)9);
+    }
+    REQUIRE(raw[3] == 9);
+    delete[] raw;
+}
+
+TEST_CASE("testBuilder") {
+    ChunkPool pool(16);
+    {
+        ByteBufferBuilder builder(pool);
+        REQUIRE(builder.size() == 0);
+        REQUIRE(builder.segments().empty());
+
+        for (int i = 0; i < 10; i++) builder.put((int16_t)i); // 20 bytes, the second chunk is split into
+        builder.putNTBS("hello earth"); // spans a chunk boundary
+        builder.order(ByteOrder::BigEndian).put((uint32_t)0x01020304);
+        REQUIRE(builder.size() == 20 + 12 + 4);
+
+        std::vector<ByteSegment> segments = builder.segments();
+        REQUIRE(segments.size() == 3);
+        REQUIRE(segments[0].size == 16);
+        REQUIRE(segments[2].size == 4);
+
+        ByteBuffer flat = builder.flatten();
+        REQUIRE(flat.capacity() == builder.size());
+        REQUIRE(flat.remaining() == builder.size());
+        for (int i = 0; i < 10; i++) REQUIRE(flat.get<int16_t>() == i);
+        REQUIRE(flat.getNTBS() == "hello earth");
+        REQUIRE(flat.order(ByteOrder::BigEndian).get<uint32_t>() == 0x01020304);
+
+#if defined(__unix__) || defined(__APPLE__)
+        std::vector<struct iovec> iov = builder.iovecs();
+        REQUIRE(iov.size() == 3);
+        REQUIRE(iov[1].iov_base == segments[1].data);
+#endif
+    }
+    // the chunks went back to the pool and are reused
+    REQUIRE(pool.available() == 3);
+    ByteBufferBuilder again(pool);
+    again.put((char)1);
+    REQUIRE(pool.available() == 2);
+}
+
+TEST_CASE("benchmark ByteBufferBuilder") {
+    const size_t count = 1024 * 1024;
+
+    BENCHMARK("oversized ByteBuffer") {
+        ByteBuffer b = ByteBuffer::allocate(1024 * 1024 * 10);
+        for (size_t i = 0; i < count; i++) b.put((int16_t)i).put((char)i);
+        return b.position();
+    };
+
+    BENCHMARK("ByteBufferBuilder") {
+        ByteBufferBuilder b;
+        for (size_t i = 0; i < count; i++) b.put((int16_t)i).put((char)i);
+        return b.size();
+    };
+
+    ChunkPool pool;
+    BENCHMARK("ByteBufferBuilder, warm pool") {
+        ByteBufferBuilder b(pool);
+        for (size_t i = 0; i < count; i++) b.put((int16_t)i).put((char)i);
+        return b.size();
+    };
+
+    BENCHMARK("ByteBufferBuilder, warm pool, flattened") {
+        ByteBufferBuilder b(pool);
+        for (size_t i = 0; i < count; i++) b.put((int16_t)i).put((char)i);
+        return b.flatten().capacity();
+    };
+}
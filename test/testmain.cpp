@@ -3,12 +3,71 @@
 
 #include "byteBuffer.hpp"
 #include "pathFileSystem.hpp"
+#include "pathFileView.hpp"
+#include "pathFileIndex.hpp"
+#include "waypointKernels.hpp"
+#include "pathSoA.hpp"
+#include "parallelFor.hpp"
+#include "pathFileDecoder.hpp"
+#include "mappedPathFile.hpp"
+#include "pathFileWriter.hpp"
+#include "pathFilePatcher.hpp"
+#include "crc32c.hpp"
+#include "metadata.hpp"
+#include "unknownParameters.hpp"
+#include "pathFileValidator.hpp"
+#include "pathColumns.hpp"
+#include "unitConversion.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory_resource>
+#include <new>
+#include <thread>
 
 using namespace lemlib;
 using namespace lemlib::PathFileSystem;
 
 using namespace std;
 
+// counts every global heap allocation made by the test program
+static std::atomic<size_t> allocationCount(0);
+
+void* operator new(size_t size) {
+    allocationCount++;
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+// std::pmr::new_delete_resource() allocates through the aligned overloads
+void* operator new(size_t size, std::align_val_t align) {
+    allocationCount++;
+    size_t alignment = std::max(sizeof(void*), (size_t)align);
+    void* p = aligned_alloc(alignment, (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+
+template <class F> static size_t countAllocations(F&& f) {
+    size_t before = allocationCount;
+    f();
+    return allocationCount - before;
+}
+
 class ArrayStreamBuffer : public std::streambuf {
     private:
         uint8_t* array;
@@ -38,74 +97,12 @@ static void writeBuf(const uint8_t* buf, const size_t size, std::ostream& out) {
     out.write(reinterpret_cast<const char*>(buf), size);
 }
 
-static void writeNTBS(const std::string& str, std::ostream& out) {
+static void writeNTBS(std::string_view str, std::ostream& out) {
     const char zero = (char)0x00;
     for (size_t i = 0; i < str.size(); i++) writeBuf(str[i], out);
     writeBuf(zero, out);
 }
 
-bool encode(const PathFile& input, uint8_t* fileBuffer, size_t& fileSize) {
-    try {
-        uint8_t metadata[256];
-        uint8_t metadataSize;
-        uint16_t pathCount;
-        uint32_t waypointCount;
-        uint8_t flag;
-
-        ByteBuffer buf = ByteBuffer::wrap(fileSize, (char*)fileBuffer);
-
-        // Start writing metadata
-        metadataSize = 0;
-        buf.put(metadataSize);
-        buf.put((char*)metadata, metadataSize);
-
-        // End writing metadata
-
-        pathCount = input.paths.size();
-        buf.put(pathCount);
-
-        for (int i = 0; i < pathCount; i++) {
-            const Path& p = input.paths[i];
-
-            buf.putNTBS(p.name);
-
-            // Start writing metadata
-            metadataSize = 0;
-            buf.put(metadataSize);
-            buf.put((char*)metadata, metadataSize);
-
-            // End writing metadata
-
-            waypointCount = p.waypoints.size();
-            buf.put(waypointCount);
-
-            for (int j = 0; j < waypointCount; j++) {
-                const Waypoint& w = p.waypoints[j];
-
-                flag = 0;
-                if (w.isHeadingAvailable) flag |= 0x01;
-                if (w.isLookaheadAvailable) flag |= 0x02;
-                buf.put(flag);
-                buf.put(w.x);
-                buf.put(w.y);
-                buf.put(w.speed);
-                if (w.isHeadingAvailable) buf.put(w.heading);
-                if (w.isLookaheadAvailable) buf.put(w.lookahead);
-                if ((flag & 0x04) != 0) buf.put<uint16_t>(0);
-                if ((flag & 0x08) != 0) buf.put<uint16_t>(0);
-                if ((flag & 0x10) != 0) buf.put<uint16_t>(0);
-                if ((flag & 0x20) != 0) buf.put<uint16_t>(0);
-                if ((flag & 0x40) != 0) buf.put<uint16_t>(0);
-                if ((flag & 0x80) != 0) buf.put<uint16_t>(0);
-            }
-        }
-
-        fileSize = buf.position();
-
-        return true;
-    } catch (std::exception& e) { return false; }
-}
-
 bool encodeUsingStream(const PathFile& input, uint8_t* fileBuffer, size_t& fileSize) {
     try {
         uint16_t zero16 = 0;
@@ -169,6 +166,124 @@ bool encodeUsingStream(const PathFile& input, uint8_t* fileBuffer, size_t& fileS
     } catch (std::exception& e) { return false; }
 }
 
+static PathFile randomPathFile(int pathCount, int minWaypoints, int maxWaypoints) {
+    PathFile pf;
+
+    for (int i = 0; i < pathCount; i++) {
+        Path p;
+        p.name = "Path " + to_string(i);
+
+        int waypointCount = minWaypoints + rand() % (maxWaypoints - minWaypoints + 1);
+        for (int j = 0; j < waypointCount; j++) {
+            Waypoint w;
+            w.x = rand() % 32768 - 16384;
+            w.y = rand() % 32768 - 16384;
+            w.speed = rand() % 65536 - 32768;
+            w.heading = rand() % 65536;
+            w.lookahead = rand() % 32768 - 16384;
+            w.isHeadingAvailable = rand() % 2;
+            w.isLookaheadAvailable = rand() % 2;
+            p.waypoints.push_back(w);
+        }
+
+        pf.paths.push_back(p);
+    }
+
+    return pf;
+}
+
+static void requireSameWaypoint(const Waypoint& a, const Waypoint& b) {
+    REQUIRE(a.x == b.x);
+    REQUIRE(a.y == b.y);
+    REQUIRE(a.speed == b.speed);
+    REQUIRE(a.isHeadingAvailable == b.isHeadingAvailable);
+    if (a.isHeadingAvailable) REQUIRE(a.heading == b.heading);
+    REQUIRE(a.isLookaheadAvailable == b.isLookaheadAvailable);
+    if (a.isLookaheadAvailable) REQUIRE(a.lookahead == b.lookahead);
+}
+
+// all waypoints of a path share the same flags, as they mostly do in files written by the editor
+static PathFile uniformPathFile(int pathCount, int waypointCount) {
+    PathFile pf = randomPathFile(pathCount, waypointCount, waypointCount);
+    for (size_t i = 0; i < pf.paths.size(); i++) {
+        for (Waypoint& w : pf.paths[i].waypoints) {
+            w.isHeadingAvailable = i % 4 == 1 || i % 4 == 3;
+            w.isLookaheadAvailable = i % 4 >= 2;
+        }
+    }
+    return pf;
+}
+
+struct ColumnBuffer {
+        std::vector<int16_t> x, y, speed, lookahead;
+        std::vector<uint16_t> heading;
+        std::vector<uint8_t> flag;
+
+        ColumnBuffer(size_t n) : x(n), y(n), speed(n), lookahead(n), heading(n), flag(n) {}
+
+        WaypointColumns columns() {
+            return {x.data(), y.data(), speed.data(), heading.data(), lookahead.data(), flag.data()};
+        }
+};
+
+static size_t decodeColumns(const uint8_t* buf, size_t size, ColumnBuffer& columns) {
+    size_t total = 0;
+    PathCursor paths = PathFileView(buf, size).paths();
+    PathView p;
+    while (paths.next(p)) total += paths.waypoints().read(columns.columns(), columns.x.size());
+    return total;
+}
+
+// consecutive waypoints a few half-millimetres apart, like the paths the editor generates
+static PathFile smoothPathFile(int pathCount, int waypointCount) {
+    PathFile pf;
+    for (int i = 0; i < pathCount; i++) {
+        Path p;
+        p.name = "Path " + to_string(i);
+        Waypoint w {int16_t(rand() % 4000 - 2000), int16_t(rand() % 4000 - 2000), 0, 0, 30, true, true};
+        for (int j = 0; j < waypointCount; j++) {
+            w.x += rand() % 21 - 10;
+            w.y += rand() % 21 - 10;
+            w.speed = std::clamp(w.speed + rand() % 41 - 20, 0, 2000);
+            w.heading = (w.heading + rand() % 201 - 100 + 62832) % 62832;
+            w.isHeadingAvailable = rand() % 8 != 0;
+            p.waypoints.push_back(w);
+        }
+        pf.paths.push_back(p);
+    }
+    return pf;
+}
+
+// a file in the temporary directory, removed at the end of the scope even if a REQUIRE fails before
+class TemporaryFile {
+    private:
+        std::string fileName;
+    public:
+        explicit TemporaryFile(const char* name)
+            : fileName((std::filesystem::temp_directory_path() / (std::string("lemlib_path_") + name)).string()) {}
+
+        TemporaryFile(const TemporaryFile&) = delete;
+        TemporaryFile& operator=(const TemporaryFile&) = delete;
+
+        ~TemporaryFile() { std::remove(fileName.c_str()); }
+
+        const char* name() const { return fileName.c_str(); }
+};
+
+static EncodeOptions encodeOptions(WaypointEncoding waypoints, bool header = true) {
+    EncodeOptions options;
+    options.waypoints = waypoints;
+    options.header = header;
+    return options;
+}
+
+template <class F> static double gigabytesPerSecond(size_t bytes, int repeats, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++) f();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (double)bytes * repeats / elapsed.count() / 1e9;
+}
+
 TEST_CASE("test encode & decode") {
     PathFile pf;
 
@@ -253,6 +368,2161 @@ TEST_CASE("benchmark encode & decode") {
     size_t size = 1024 * 1024 * 10;
     BENCHMARK("encode") { encode(pf, buf, size); };
 
+    BENCHMARK("encodedSize") { return encodedSize(pf); };
+
+    std::vector<uint8_t> encoded;
+    BENCHMARK("encode to vector") { return encode(pf, encoded); };
+
     PathFile pf2;
     BENCHMARK("decode") { decode(buf, size, pf2); };
+
+    PathFile reused;
+    BENCHMARK("decode into reused") { return decodeInto(buf, size, reused); };
+
+    BENCHMARK("decode view") {
+        int32_t sum = 0;
+        PathFileView view(buf, size);
+        PathCursor paths = view.paths();
+        PathView p;
+        Waypoint w;
+        while (paths.next(p)) {
+            WaypointCursor waypoints = p.waypoints();
+            while (waypoints.next(w)) sum += w.x + w.y + w.speed;
+        }
+        return sum;
+    };
+
+    ColumnBuffer columns(1000);
+    const DecodeKernel best = decodeKernel();
+    setDecodeKernel(DecodeKernel::Scalar);
+    BENCHMARK("decode columns (scalar)") { return decodeColumns(buf, size, columns); };
+    setDecodeKernel(best);
+    BENCHMARK("decode columns (" + std::string(decodeKernelName(best)) + ")") {
+        return decodeColumns(buf, size, columns);
+    };
+
+    size_t uniformSize = 1024 * 1024 * 10;
+    uint8_t* uniformBuf = new uint8_t[uniformSize];
+    REQUIRE(encode(uniformPathFile(100, 1000), uniformBuf, uniformSize));
+
+    for (DecodeKernel kernel : {DecodeKernel::Scalar, DecodeKernel::SSE41, DecodeKernel::AVX2}) {
+        if (!setDecodeKernel(kernel)) continue;
+        double mixed = gigabytesPerSecond(size, 20, [&] { decodeColumns(buf, size, columns); });
+        double uniform = gigabytesPerSecond(uniformSize, 20, [&] { decodeColumns(uniformBuf, uniformSize, columns); });
+        std::cout << "decode columns (" << decodeKernelName(kernel) << "): " << mixed << " GB/s random flags, "
+                  << uniform << " GB/s uniform flags" << std::endl;
+    }
+    setDecodeKernel(best);
+    PathFile pf3;
+    std::cout << "decode: " << gigabytesPerSecond(size, 20, [&] {
+        pf3.paths.clear();
+        decode(buf, size, pf3);
+    }) << " GB/s" << std::endl;
+    delete[] uniformBuf;
+
+    BENCHMARK("decode soa") {
+        PathSoAFile soa;
+        decode(buf, size, soa);
+        return soa.paths.size();
+    };
+
+    BENCHMARK("scan") {
+        std::vector<PathIndexEntry> index;
+        scan(buf, size, index);
+        return index.size();
+    };
+
+    BENCHMARK("lazy open & decode one path") {
+        LazyPathFile lazy;
+        lazy.open(buf, size);
+        return lazy.path("Path 50")->waypoints.size();
+    };
+}
+
+TEST_CASE("test path file view") {
+    PathFile pf = randomPathFile(20, 1, 500);
+
+    uint8_t* buf = new uint8_t[1024 * 1024];
+    size_t size = 1024 * 1024;
+    REQUIRE(encode(pf, buf, size));
+
+    PathFileView view(buf, size);
+    REQUIRE(view.valid());
+    REQUIRE(view.pathCount() == pf.paths.size());
+    REQUIRE(view.metadata().size == 0);
+
+    PathCursor paths = view.paths();
+    PathView p;
+    for (size_t i = 0; i < pf.paths.size(); i++) {
+        REQUIRE(paths.next(p));
+        REQUIRE(p.name() == pf.paths[i].name);
+        REQUIRE(p.waypointCount() == pf.paths[i].waypoints.size());
+
+        // leave every other path unread so the cursor has to skip it
+        if (i % 2 == 1) continue;
+
+        WaypointCursor waypoints = p.waypoints();
+        Waypoint w;
+        for (size_t j = 0; j < pf.paths[i].waypoints.size(); j++) {
+            REQUIRE(waypoints.next(w));
+            requireSameWaypoint(pf.paths[i].waypoints[j], w);
+        }
+        REQUIRE_FALSE(waypoints.next(w));
+        REQUIRE_FALSE(waypoints.failed());
+    }
+    REQUIRE_FALSE(paths.next(p));
+    REQUIRE_FALSE(paths.failed());
+
+    // with the header a truncated file is refused up front
+    REQUIRE_FALSE(PathFileView(buf, size - 1).valid());
+
+    // without one, the cursors report it instead of decoding garbage
+    EncodeOptions headerless;
+    headerless.header = false;
+    size = 1024 * 1024;
+    REQUIRE(encode(pf, buf, size, headerless));
+    PathCursor truncated = PathFileView(buf, size - 1).paths();
+    size_t seen = 0;
+    while (truncated.next(p)) {
+        WaypointCursor waypoints = p.waypoints();
+        while (waypoints.skip()) {}
+        seen++;
+    }
+    REQUIRE(truncated.failed());
+    REQUIRE(seen == pf.paths.size());
+
+    delete[] buf;
+}
+
+TEST_CASE("test lazy path file") {
+    PathFile pf = randomPathFile(30, 0, 300);
+
+    uint8_t* buf = new uint8_t[1024 * 1024];
+    size_t size = 1024 * 1024;
+    REQUIRE(encode(pf, buf, size));
+
+    std::vector<PathIndexEntry> index;
+    REQUIRE(scan(buf, size, index));
+    REQUIRE(index.size() == pf.paths.size());
+    for (size_t i = 0; i < index.size(); i++) {
+        REQUIRE(index[i].name == pf.paths[i].name);
+        REQUIRE(index[i].waypointCount == pf.paths[i].waypoints.size());
+        REQUIRE(index[i].waypointOffset == index[i].offset + pf.paths[i].name.size() + 1 + 1 + 4);
+        if (i + 1 < index.size()) REQUIRE(index[i].offset + index[i].size == index[i + 1].offset);
+    }
+    REQUIRE(index.back().offset + index.back().size == size);
+
+    LazyPathFile lazy;
+    REQUIRE(lazy.open(buf, size));
+    REQUIRE(lazy.size() == pf.paths.size());
+    REQUIRE(lazy.find("Path 17") == 17);
+    REQUIRE(lazy.find("Path 99") == -1);
+    REQUIRE(lazy.path("Path 99") == nullptr);
+    REQUIRE(lazy.path(pf.paths.size()) == nullptr);
+
+    const Path* p = lazy.path("Path 17");
+    REQUIRE(p != nullptr);
+    REQUIRE(p == lazy.path(17)); // decoded once, then cached
+    REQUIRE(p->name == "Path 17");
+    REQUIRE(p->waypoints.size() == pf.paths[17].waypoints.size());
+    for (size_t j = 0; j < p->waypoints.size(); j++) requireSameWaypoint(pf.paths[17].waypoints[j], p->waypoints[j]);
+
+    REQUIRE_FALSE(lazy.open(buf, size - 1));
+    REQUIRE_FALSE(lazy.verify());
+
+    // without verify only the path headers are read, and a changed waypoint is left to verify()
+    REQUIRE(lazy.open(buf, size, false));
+    REQUIRE(lazy.verify());
+    const PathIndexEntry& longest =
+        *std::max_element(index.begin(), index.end(), [](const PathIndexEntry& a, const PathIndexEntry& b) {
+            return a.waypointCount < b.waypointCount;
+        });
+    REQUIRE(longest.waypointCount > 0);
+    buf[longest.waypointOffset + 1] ^= 0x10;
+    REQUIRE_FALSE(lazy.open(buf, size));
+    REQUIRE(lazy.open(buf, size, false));
+    REQUIRE(lazy.size() == pf.paths.size());
+    REQUIRE_FALSE(lazy.verify());
+
+    delete[] buf;
+}
+
+TEST_CASE("test column decode kernels") {
+    PathFile pf = uniformPathFile(8, 333);
+    PathFile mixed = randomPathFile(8, 0, 333);
+    pf.paths.insert(pf.paths.end(), mixed.paths.begin(), mixed.paths.end());
+
+    uint8_t* buf = new uint8_t[1024 * 1024];
+    size_t size = 1024 * 1024;
+    REQUIRE(encode(pf, buf, size));
+
+    const DecodeKernel best = decodeKernel();
+    for (DecodeKernel kernel : {DecodeKernel::Scalar, DecodeKernel::SSE41, DecodeKernel::AVX2}) {
+        if (!setDecodeKernel(kernel)) continue;
+
+        PathCursor paths = PathFileView(buf, size).paths();
+        PathView p;
+        for (size_t i = 0; i < pf.paths.size(); i++) {
+            REQUIRE(paths.next(p));
+            ColumnBuffer columns(p.waypointCount());
+            WaypointCursor waypoints = p.waypoints();
+            // split the reads so runs are cut at arbitrary places
+            size_t n = waypoints.read(columns.columns(), 37);
+            n += waypoints.read(columns.columns().advanced(n), p.waypointCount());
+            REQUIRE(n == pf.paths[i].waypoints.size());
+            REQUIRE_FALSE(waypoints.failed());
+
+            for (size_t j = 0; j < n; j++) {
+                const Waypoint& w = pf.paths[i].waypoints[j];
+                REQUIRE(columns.x[j] == w.x);
+                REQUIRE(columns.y[j] == w.y);
+                REQUIRE(columns.speed[j] == w.speed);
+                REQUIRE(columns.flag[j] == (w.isHeadingAvailable ? 0x01 : 0) + (w.isLookaheadAvailable ? 0x02 : 0));
+                REQUIRE(columns.heading[j] == (w.isHeadingAvailable ? w.heading : 0));
+                REQUIRE(columns.lookahead[j] == (w.isLookaheadAvailable ? w.lookahead : 0));
+            }
+        }
+    }
+
+    // records carrying unknown parameters are strided over without reading past the buffer
+    const int count = 40;
+    std::vector<uint8_t> records;
+    for (int i = 0; i < count; i++) {
+        const uint8_t record[] = {0x85, (uint8_t)i, 0, 2, 0, 3, 0, 4, 0, 9, 9, 9, 9};
+        records.insert(records.end(), std::begin(record), std::end(record));
+    }
+    for (DecodeKernel kernel : {DecodeKernel::Scalar, DecodeKernel::SSE41, DecodeKernel::AVX2}) {
+        if (!setDecodeKernel(kernel)) continue;
+
+        ColumnBuffer columns(count);
+        WaypointCursor waypoints(records.data(), records.data() + records.size(), count);
+        REQUIRE(waypoints.read(columns.columns(), count) == count);
+        for (int i = 0; i < count; i++) {
+            REQUIRE(columns.x[i] == i);
+            REQUIRE(columns.y[i] == 2);
+            REQUIRE(columns.speed[i] == 3);
+            REQUIRE(columns.heading[i] == 4);
+            REQUIRE(columns.lookahead[i] == 0);
+        }
+    }
+    setDecodeKernel(best);
+
+    delete[] buf;
+}
+
+TEST_CASE("test structure of arrays") {
+    PathFile pf = uniformPathFile(8, 300);
+    PathFile mixed = randomPathFile(8, 0, 300);
+    pf.paths.insert(pf.paths.end(), mixed.paths.begin(), mixed.paths.end());
+
+    uint8_t* buf = new uint8_t[1024 * 1024];
+    size_t size = 1024 * 1024;
+    REQUIRE(encode(pf, buf, size));
+
+    PathSoAFile soa;
+    REQUIRE(decode(buf, size, soa));
+    REQUIRE(soa.paths.size() == pf.paths.size());
+
+    for (size_t i = 0; i < pf.paths.size(); i++) {
+        const PathSoA& p = soa.paths[i];
+        REQUIRE(std::string_view(p.name) == pf.paths[i].name);
+        REQUIRE(p.size() == pf.paths[i].waypoints.size());
+        REQUIRE((uintptr_t)p.x.data() % simdAlignment == 0);
+        REQUIRE((uintptr_t)p.heading.data() % simdAlignment == 0);
+        for (size_t j = 0; j < p.size(); j++) requireSameWaypoint(pf.paths[i].waypoints[j], p.waypoint(j));
+
+        // conversion helpers agree with the direct decoder
+        PathSoA converted;
+        toSoA(pf.paths[i], converted);
+        REQUIRE(converted.x == p.x);
+        REQUIRE(converted.heading == p.heading);
+        REQUIRE(converted.headingPresent == p.headingPresent);
+        REQUIRE(converted.lookaheadPresent == p.lookaheadPresent);
+
+        Path back;
+        toPath(p, back);
+        REQUIRE(back.name == pf.paths[i].name);
+        for (size_t j = 0; j < p.size(); j++) requireSameWaypoint(pf.paths[i].waypoints[j], back.waypoints[j]);
+    }
+
+    // encoding the columns gives the same bytes as encoding the waypoints
+    uint8_t* buf2 = new uint8_t[1024 * 1024];
+    size_t size2 = 1024 * 1024;
+    REQUIRE(encode(soa, buf2, size2));
+    REQUIRE(size2 == size);
+    REQUIRE(memcmp(buf, buf2, size) == 0);
+
+    size2 = size - 1;
+    REQUIRE_FALSE(encode(soa, buf2, size2));
+
+    // a body the size field of the header cannot hold is refused before anything is written
+    EncodeOptions oversized;
+    oversized.editorData = {buf, (size_t)UINT32_MAX + 1};
+    size2 = SIZE_MAX;
+    REQUIRE_FALSE(encode(soa, buf2, size2, oversized));
+    size2 = SIZE_MAX;
+    REQUIRE_FALSE(encode(pf, buf2, size2, oversized));
+    const uint8_t editorData[] = "editor data";
+    oversized.header = false;
+    oversized.editorData = {editorData, sizeof(editorData)};
+    size2 = 1024 * 1024;
+    REQUIRE(encode(soa, buf2, size2, oversized));
+    size = 1024 * 1024;
+    REQUIRE(encode(pf, buf, size, oversized));
+    REQUIRE(size2 == size);
+    REQUIRE(memcmp(buf, buf2, size) == 0);
+
+    // the file metadata survives a round trip through the columns, and the size is known before encoding
+    for (WaypointEncoding encoding : {WaypointEncoding::Plain, WaypointEncoding::Delta}) {
+        PathFile withMetadata = pf;
+        REQUIRE(appendMetadata(withMetadata.metadata, 0x20, uint32_t(1234)));
+        REQUIRE(appendMetadata(withMetadata.metadata, 0x21, uint8_t(7)));
+        std::vector<uint8_t> encoded;
+        REQUIRE(encode(withMetadata, encoded, encodeOptions(encoding)));
+
+        PathSoAFile columns;
+        REQUIRE(decode(encoded.data(), encoded.size(), columns));
+        REQUIRE(columns.metadata == withMetadata.metadata);
+        REQUIRE(encodedSize(columns, encodeOptions(encoding)) == encoded.size());
+        std::vector<uint8_t> again;
+        REQUIRE(encode(columns, again, encodeOptions(encoding)));
+        REQUIRE(again == encoded);
+
+        // the encoding entry is written by the encoder alone
+        REQUIRE(appendMetadata(columns.metadata, format::waypointEncodingTag, uint8_t(0)));
+        REQUIRE_FALSE(encode(columns, again, encodeOptions(encoding)));
+    }
+
+    // names decode() could not read back are refused like by the PathFile encoder
+    for (const std::string& name : {std::string(1024, 'n'), std::string("a\0b", 3)}) {
+        PathSoAFile named = soa;
+        named.paths[3].name = name;
+        size2 = 1024 * 1024;
+        REQUIRE_FALSE(encode(named, buf2, size2));
+        pf.paths[3].name = name;
+        size2 = 1024 * 1024;
+        REQUIRE_FALSE(encode(pf, buf2, size2));
+    }
+
+    delete[] buf;
+    delete[] buf2;
+}
+
+TEST_CASE("test parallel decode") {
+    std::vector<std::atomic<int>> hits(5000);
+    parallelFor(hits.size(), 7, [&](size_t i) { hits[i]++; });
+    for (auto& h : hits) REQUIRE(h == 1);
+
+    PathFile pf = randomPathFile(64, 0, 400);
+
+    uint8_t* buf = new uint8_t[1024 * 1024];
+    size_t size = 1024 * 1024;
+    REQUIRE(encode(pf, buf, size));
+
+    PathFile sequential;
+    REQUIRE(decode(buf, size, sequential));
+
+    for (unsigned threads : {1u, 2u, 3u, 8u, 0u}) {
+        PathFile parallel;
+        REQUIRE(decodeParallel(buf, size, parallel, threads));
+        REQUIRE(parallel.paths.size() == sequential.paths.size());
+        for (size_t i = 0; i < parallel.paths.size(); i++) {
+            REQUIRE(parallel.paths[i].name == sequential.paths[i].name);
+            REQUIRE(parallel.paths[i].waypoints.size() == sequential.paths[i].waypoints.size());
+            for (size_t j = 0; j < parallel.paths[i].waypoints.size(); j++)
+                requireSameWaypoint(sequential.paths[i].waypoints[j], parallel.paths[i].waypoints[j]);
+        }
+    }
+
+    PathFile truncated;
+    REQUIRE_FALSE(decodeParallel(buf, size - 1, truncated, 4));
+
+    delete[] buf;
+}
+
+TEST_CASE("test parallel encode") {
+    PathFile pf = randomPathFile(70, 0, 400);
+
+    std::vector<uint8_t> sequential;
+    REQUIRE(encode(pf, sequential));
+
+    for (unsigned threads : {1u, 2u, 3u, 8u, 0u}) {
+        std::vector<uint8_t> parallel;
+        REQUIRE(encodeParallel(pf, parallel, threads));
+        REQUIRE(parallel == sequential);
+
+        std::vector<uint8_t> buf(sequential.size());
+        size_t size = buf.size();
+        REQUIRE(encodeParallel(pf, buf.data(), size, threads));
+        REQUIRE(size == sequential.size());
+        REQUIRE(buf == sequential);
+        size = buf.size() - 1;
+        REQUIRE_FALSE(encodeParallel(pf, buf.data(), size, threads));
+    }
+
+    PathFile empty;
+    std::vector<uint8_t> parallel;
+    REQUIRE(encodeParallel(empty, parallel, 4));
+    REQUIRE(encode(empty, sequential));
+    REQUIRE(parallel == sequential);
+}
+
+TEST_CASE("benchmark parallel encode") {
+    PathFile pf = randomPathFile(2000, 500, 1500);
+    std::vector<uint8_t> out;
+
+    BENCHMARK("encode") { return encode(pf, out); };
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= cores; threads = threads < cores && threads * 2 > cores ? cores : threads * 2) {
+        BENCHMARK("encode parallel, " + to_string(threads) + " threads") { return encodeParallel(pf, out, threads); };
+    }
+}
+
+TEST_CASE("benchmark parallel decode") {
+    PathFile pf = randomPathFile(2000, 500, 1500);
+
+    size_t size = 1024 * 1024 * 64;
+    uint8_t* buf = new uint8_t[size];
+    REQUIRE(encode(pf, buf, size));
+
+    BENCHMARK("decode") {
+        PathFile out;
+        decode(buf, size, out);
+        return out.paths.size();
+    };
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= cores; threads = threads < cores && threads * 2 > cores ? cores : threads * 2) {
+        BENCHMARK("decode parallel, " + to_string(threads) + " threads") {
+            PathFile out;
+            decodeParallel(buf, size, out, threads);
+            return out.paths.size();
+        };
+    }
+
+    delete[] buf;
+}
+
+TEST_CASE("test chunked decoder") {
+    PathFile pf = randomPathFile(12, 0, 200);
+    pf.paths[3].name = std::string(1023, 'n'); // the longest name decode() accepts
+
+    uint8_t* buf = new uint8_t[1024 * 1024];
+    size_t size = 1024 * 1024;
+    REQUIRE(encode(pf, buf, size));
+
+    PathFile expected;
+    REQUIRE(decode(buf, size, expected));
+
+    for (size_t chunk : {1, 2, 3, 7, 64, 1000, 1 << 20}) {
+        PathFile pf2;
+        PathFileDecoder decoder([&](Path&& p) { pf2.paths.push_back(std::move(p)); });
+
+        for (size_t i = 0; i < size; i += chunk) {
+            PathFileDecoder::Status status = decoder.feed(buf + i, std::min(chunk, size - i));
+            REQUIRE(status == (i + chunk >= size ? PathFileDecoder::Status::Done
+                                                 : PathFileDecoder::Status::NeedMoreData));
+        }
+
+        REQUIRE(decoder.pathCount() == expected.paths.size());
+        REQUIRE(pf2.paths.size() == expected.paths.size());
+        for (size_t i = 0; i < pf2.paths.size(); i++) {
+            REQUIRE(pf2.paths[i].name == expected.paths[i].name);
+            REQUIRE(pf2.paths[i].waypoints.size() == expected.paths[i].waypoints.size());
+            for (size_t j = 0; j < pf2.paths[i].waypoints.size(); j++)
+                requireSameWaypoint(expected.paths[i].waypoints[j], pf2.paths[i].waypoints[j]);
+        }
+    }
+
+    // a path is emitted as soon as its last byte arrives
+    std::vector<PathIndexEntry> index;
+    REQUIRE(scan(buf, size, index));
+    size_t emitted = 0;
+    PathFileDecoder decoder([&](Path&&) { emitted++; });
+    size_t fed = 0;
+    for (size_t i = 0; i < index.size(); i++) {
+        size_t pathEnd = index[i].offset + index[i].size;
+        REQUIRE(decoder.feed(buf + fed, pathEnd - 1 - fed) == PathFileDecoder::Status::NeedMoreData);
+        REQUIRE(emitted == i);
+        decoder.feed(buf + pathEnd - 1, 1);
+        REQUIRE(emitted == i + 1);
+        fed = pathEnd;
+    }
+    REQUIRE(decoder.status() == PathFileDecoder::Status::Done);
+
+    delete[] buf;
+}
+
+TEST_CASE("test memory mapped file") {
+    PathFile pf = randomPathFile(10, 1, 300);
+
+    uint8_t* buf = new uint8_t[1024 * 1024];
+    size_t size = 1024 * 1024;
+    REQUIRE(encode(pf, buf, size));
+
+    const TemporaryFile temporary("testMappedPathFile.bin");
+    const char* fileName = temporary.name();
+    FILE* file = fopen(fileName, "wb");
+    REQUIRE(file != nullptr);
+    REQUIRE(fwrite(buf, 1, size, file) == size);
+    fclose(file);
+
+    MappedPathFile mapped = PathFileSystem::open(fileName);
+    REQUIRE(mapped.isOpen());
+    REQUIRE(mapped.size() == size);
+    REQUIRE(memcmp(mapped.data(), buf, size) == 0);
+
+    PathFile pf2;
+    REQUIRE(mapped.decode(pf2));
+    REQUIRE(pf2.paths.size() == pf.paths.size());
+    for (size_t i = 0; i < pf.paths.size(); i++) {
+        REQUIRE(pf2.paths[i].name == pf.paths[i].name);
+        REQUIRE(pf2.paths[i].waypoints.size() == pf.paths[i].waypoints.size());
+    }
+
+    // ownership moves with the object and the view reads straight from the mapping
+    MappedPathFile moved = std::move(mapped);
+    REQUIRE_FALSE(mapped.isOpen());
+    PathFileView view = moved.view();
+    REQUIRE(view.valid());
+    REQUIRE(view.pathCount() == pf.paths.size());
+    REQUIRE(view.firstPath() > moved.data());
+    REQUIRE(view.firstPath() < moved.data() + moved.size());
+
+    moved.close();
+    REQUIRE_FALSE(moved.isOpen());
+
+    // an empty file opens as an empty mapping, which holds no paths; a missing one does not open
+    fclose(fopen(fileName, "wb"));
+    MappedPathFile empty = PathFileSystem::open(fileName);
+    REQUIRE(empty.isOpen());
+    REQUIRE(empty.size() == 0);
+    REQUIRE_FALSE(empty.view().valid());
+    REQUIRE_FALSE(empty.decode(pf2));
+    MappedPathFile reopened = std::move(empty);
+    REQUIRE(reopened.isOpen());
+    REQUIRE_FALSE(empty.isOpen());
+    reopened.close();
+    REQUIRE_FALSE(reopened.isOpen());
+
+    errno = 0;
+    REQUIRE_FALSE(PathFileSystem::open("doesNotExist.bin").isOpen());
+    REQUIRE(errno == ENOENT);
+
+    delete[] buf;
+}
+
+TEST_CASE("test encoder") {
+    PathFile pf = randomPathFile(40, 0, 300);
+
+    std::vector<uint8_t> encoded;
+    REQUIRE(encode(pf, encoded));
+    REQUIRE(encoded.size() == encodedSize(pf));
+
+    // the stream based reference encoder writes the body the header covers, byte for byte
+    std::vector<uint8_t> reference(encoded.size() - format::fileHeaderSize);
+    size_t referenceSize = reference.size();
+    REQUIRE(encodeUsingStream(pf, reference.data(), referenceSize));
+    REQUIRE(std::equal(reference.begin(), reference.end(), encoded.begin() + format::fileHeaderSize));
+
+    // an exactly sized caller buffer is enough, one byte less is not
+    std::vector<uint8_t> exact(encodedSize(pf));
+    size_t size = exact.size();
+    REQUIRE(encode(pf, exact.data(), size));
+    REQUIRE(size == exact.size());
+    REQUIRE(exact == encoded);
+    size = exact.size() - 1;
+    REQUIRE_FALSE(encode(pf, exact.data(), size));
+
+    PathFile pf2;
+    REQUIRE(decode(encoded.data(), encoded.size(), pf2));
+    REQUIRE(pf2.paths.size() == pf.paths.size());
+
+    const TemporaryFile temporary("testEncoder.bin");
+    const char* fileName = temporary.name();
+    FILE* file = fopen(fileName, "wb");
+    REQUIRE(file != nullptr);
+    REQUIRE(encodeToFile(pf, fileno(file)));
+    fclose(file);
+    MappedPathFile mapped = PathFileSystem::open(fileName);
+    REQUIRE(mapped.size() == encoded.size());
+    REQUIRE(memcmp(mapped.data(), encoded.data(), encoded.size()) == 0);
+    mapped.close();
+
+    // names decode() could not read back are refused
+    pf.paths[0].name = std::string(1024, 'n');
+    REQUIRE_FALSE(encode(pf, encoded));
+    pf.paths[0].name = std::string("a\0b", 3);
+    REQUIRE_FALSE(encode(pf, encoded));
+}
+
+static std::vector<uint8_t> readFile(const char* fileName) {
+    MappedPathFile mapped = PathFileSystem::open(fileName);
+    if (!mapped.isOpen()) return {};
+    return std::vector<uint8_t>(mapped.data(), mapped.data() + mapped.size());
+}
+
+static bool writeWith(PathFileWriter& writer, const PathFile& pf, const char* fileName) {
+    FILE* file = fopen(fileName, "wb");
+    if (file == nullptr) return false;
+    bool ok = writer.write(pf, fileno(file));
+    fclose(file);
+    return ok;
+}
+
+TEST_CASE("test scatter gather writer") {
+    // more segments than a single writev call accepts
+    PathFile pf = randomPathFile(700, 0, 40);
+    pf.paths[1].waypoints.clear();
+    const TemporaryFile temporary("testPathFileWriter.bin");
+    const char* fileName = temporary.name();
+
+    std::vector<uint8_t> encoded;
+    PathFileWriter writer;
+    REQUIRE(encode(pf, encoded));
+    REQUIRE(writeWith(writer, pf, fileName));
+    REQUIRE(writer.encodedPaths() == pf.paths.size());
+    REQUIRE(readFile(fileName) == encoded);
+
+    // nothing changed, nothing is encoded again
+    REQUIRE(writeWith(writer, pf, fileName));
+    REQUIRE(writer.encodedPaths() == 0);
+    REQUIRE(readFile(fileName) == encoded);
+
+    // edits in place are picked up without invalidate()
+    pf.paths[3].waypoints[0].speed += 1;
+    REQUIRE(encode(pf, encoded));
+    REQUIRE(writeWith(writer, pf, fileName));
+    REQUIRE(writer.encodedPaths() == 1);
+    REQUIRE(readFile(fileName) == encoded);
+    PathFile onDisk;
+    std::vector<uint8_t> saved = readFile(fileName);
+    REQUIRE(decode(saved.data(), saved.size(), onDisk));
+    REQUIRE(onDisk.paths[3].waypoints[0].speed == pf.paths[3].waypoints[0].speed);
+    pf.paths[4].waypoints.back().isHeadingAvailable = !pf.paths[4].waypoints.back().isHeadingAvailable;
+    pf.paths[5].waypoints.back().lookahead += 1;
+    REQUIRE(encode(pf, encoded));
+    REQUIRE(writeWith(writer, pf, fileName));
+    REQUIRE(writer.encodedPaths() == 2);
+    REQUIRE(readFile(fileName) == encoded);
+    pf.paths[9].waypoints.resize(std::max<size_t>(pf.paths[9].waypoints.size(), 1));
+    REQUIRE(encode(pf, encoded));
+    REQUIRE(writeWith(writer, pf, fileName));
+    pf.paths[9].unknownParameters.push_back({0, 0x04, {7}});
+    REQUIRE(encode(pf, encoded));
+    REQUIRE(writeWith(writer, pf, fileName));
+    REQUIRE(writer.encodedPaths() == 1);
+    REQUIRE(readFile(fileName) == encoded);
+    pf.paths[9].unknownParameters[0].values[0] = 8;
+    REQUIRE(encode(pf, encoded));
+    REQUIRE(writeWith(writer, pf, fileName));
+    REQUIRE(writer.encodedPaths() == 1);
+    REQUIRE(readFile(fileName) == encoded);
+
+    // invalidate() encodes a path again even if nothing changed
+    writer.invalidate(3);
+    REQUIRE(writeWith(writer, pf, fileName));
+    REQUIRE(writer.encodedPaths() == 1);
+    REQUIRE(readFile(fileName) == encoded);
+
+    // a changed waypoint count or name, or a new path, is picked up on its own
+    pf.paths[5].waypoints.push_back(pf.paths[6].waypoints[0]);
+    pf.paths[7].name += "x";
+    pf.paths.push_back(pf.paths[8]);
+    REQUIRE(encode(pf, encoded));
+    REQUIRE(writeWith(writer, pf, fileName));
+    REQUIRE(writer.encodedPaths() == 3);
+    REQUIRE(readFile(fileName) == encoded);
+
+    std::vector<ByteSpan> segments;
+    REQUIRE(writer.segments(pf, segments));
+    std::vector<uint8_t> joined;
+    for (const ByteSpan& s : segments) joined.insert(joined.end(), s.data, s.data + s.size);
+    REQUIRE(joined == encoded);
+
+    // positioned writes leave the bytes before the offset alone
+    FILE* file = fopen(fileName, "wb");
+    REQUIRE(file != nullptr);
+    REQUIRE(fwrite("abcd", 1, 4, file) == 4);
+    fflush(file);
+    REQUIRE(writer.write(pf, fileno(file), 4));
+    fclose(file);
+    std::vector<uint8_t> written = readFile(fileName);
+    REQUIRE(written.size() == encoded.size() + 4);
+    REQUIRE(memcmp(written.data(), "abcd", 4) == 0);
+    REQUIRE(std::equal(encoded.begin(), encoded.end(), written.begin() + 4));
+
+    // saving a shorter file over a longer one, opened without truncating it, leaves no old bytes behind
+    PathFile shorter = pf;
+    shorter.paths.resize(10);
+    std::vector<uint8_t> shorterEncoded;
+    REQUIRE(encode(shorter, shorterEncoded, encodeOptions(WaypointEncoding::Plain, false)));
+    PathFileWriter headerless(encodeOptions(WaypointEncoding::Plain, false));
+    for (bool positioned : {true, false}) {
+        REQUIRE(writeWith(writer, pf, fileName));
+        file = fopen(fileName, "r+b");
+        REQUIRE(file != nullptr);
+        const bool ok =
+            positioned ? headerless.write(shorter, fileno(file), 0) : headerless.write(shorter, fileno(file));
+        fclose(file);
+        REQUIRE(ok);
+        saved = readFile(fileName);
+        REQUIRE(saved == shorterEncoded);
+        REQUIRE(PathFileView(saved.data(), saved.size()).editorData().size == 0);
+    }
+
+    writer.invalidateAll();
+    REQUIRE(writer.segments(pf, segments));
+    REQUIRE(writer.encodedPaths() == pf.paths.size());
+
+    pf.paths[0].name = std::string("a\0b", 3);
+    REQUIRE_FALSE(writer.segments(pf, segments));
+}
+
+TEST_CASE("benchmark scatter gather writer") {
+    PathFile pf = randomPathFile(200, 500, 1500);
+    const TemporaryFile temporary("benchmarkPathFileWriter.bin");
+    const char* fileName = temporary.name();
+    FILE* file = fopen(fileName, "wb");
+    REQUIRE(file != nullptr);
+
+    PathFileWriter writer;
+    REQUIRE(writer.write(pf, fileno(file), 0));
+
+    BENCHMARK("encodeToFile") {
+        rewind(file);
+        return encodeToFile(pf, fileno(file));
+    };
+
+    BENCHMARK("writer, every path changed") {
+        writer.invalidateAll();
+        return writer.write(pf, fileno(file), 0);
+    };
+
+    BENCHMARK("writer, one path changed") {
+        pf.paths[17].waypoints[0].speed += 1;
+        writer.invalidate(17);
+        return writer.write(pf, fileno(file), 0);
+    };
+
+    fclose(file);
+}
+
+TEST_CASE("test path file patcher") {
+    PathFile pf = randomPathFile(30, 1, 200);
+    const std::string editorData = "editor data";
+
+    // the patched image has to match a fresh encode of the same edits, editor data included
+    auto encodeWithEditorData = [&](const PathFile& file) {
+        std::vector<uint8_t> out;
+        REQUIRE(encode(file, out));
+        out.insert(out.end(), editorData.begin(), editorData.end());
+        return out;
+    };
+
+    PathFilePatcher patcher;
+    REQUIRE_FALSE(patcher.open({1, 2}));
+    REQUIRE(patcher.open(encodeWithEditorData(pf)));
+    REQUIRE(patcher.size() == pf.paths.size());
+    REQUIRE(patcher.name(4) == pf.paths[4].name);
+    REQUIRE(patcher.find(pf.paths[4].name) <= 4);
+    REQUIRE(patcher.find("not a path") == -1);
+
+    Waypoint w = pf.paths[2].waypoints.back();
+    w.x += 5;
+    w.speed = -w.speed;
+    REQUIRE(patcher.setWaypoint(2, pf.paths[2].waypoints.size() - 1, w));
+    pf.paths[2].waypoints.back() = w;
+    REQUIRE(patcher.image() == encodeWithEditorData(pf));
+
+    // a record's flag byte never changes
+    w.isHeadingAvailable = !w.isHeadingAvailable;
+    REQUIRE_FALSE(patcher.setWaypoint(2, pf.paths[2].waypoints.size() - 1, w));
+    REQUIRE_FALSE(patcher.setWaypoint(2, pf.paths[2].waypoints.size(), pf.paths[2].waypoints[0]));
+
+    REQUIRE(patcher.rename(7, "a much longer name than before"));
+    pf.paths[7].name = "a much longer name than before";
+    REQUIRE(patcher.rename(8, ""));
+    pf.paths[8].name = "";
+    REQUIRE_FALSE(patcher.rename(9, std::string(1024, 'n')));
+    REQUIRE(patcher.image() == encodeWithEditorData(pf));
+
+    Path added = randomPathFile(1, 10, 10).paths[0];
+    REQUIRE(patcher.appendPath(added));
+    pf.paths.push_back(added);
+    REQUIRE(patcher.image() == encodeWithEditorData(pf));
+
+    REQUIRE(patcher.remove(0));
+    pf.paths.erase(pf.paths.begin());
+    REQUIRE_FALSE(patcher.remove(pf.paths.size()));
+    REQUIRE(patcher.image() == encodeWithEditorData(pf));
+
+    // offsets of paths after the edits were kept up to date
+    w = pf.paths[20].waypoints[0];
+    w.y += 1;
+    REQUIRE(patcher.setWaypoint(20, 0, w));
+    pf.paths[20].waypoints[0] = w;
+    REQUIRE(patcher.name(pf.paths.size() - 1) == added.name);
+    REQUIRE(patcher.image() == encodeWithEditorData(pf));
+
+    std::vector<uint8_t> image = patcher.release();
+    REQUIRE(patcher.size() == 0);
+    PathFile decoded;
+    REQUIRE(decode(image.data(), image.size(), decoded));
+    REQUIRE(decoded.paths.size() == pf.paths.size());
+
+    // decode reads a name of maxNameLength characters without a null byte after it
+    PathFile small = randomPathFile(3, 1, 20);
+    small.paths[1].name = std::string(format::maxNameLength - 1, 'n');
+    for (bool header : {true, false}) {
+        std::vector<uint8_t> unterminated;
+        REQUIRE(encode(small, unterminated, encodeOptions(WaypointEncoding::Plain, header)));
+        const size_t nul = std::search_n(unterminated.begin(), unterminated.end(), format::maxNameLength - 1, 'n') -
+                           unterminated.begin() + format::maxNameLength - 1;
+        REQUIRE(unterminated[nul] == 0);
+        unterminated[nul] = 'n';
+        if (header) {
+            format::store(unterminated.data() + format::checksumOffset,
+                          crc32c(unterminated.data() + format::fileHeaderSize,
+                                 unterminated.size() - format::fileHeaderSize));
+        }
+        PathFile longName;
+        REQUIRE(decode(unterminated.data(), unterminated.size(), longName));
+        REQUIRE(std::string_view(longName.paths[1].name) == std::string(format::maxNameLength, 'n'));
+
+        REQUIRE(patcher.open(unterminated));
+        REQUIRE(patcher.name(1) == std::string(format::maxNameLength, 'n'));
+        REQUIRE(patcher.find(std::string(format::maxNameLength, 'n')) == 1);
+        REQUIRE(patcher.rename(1, "short"));
+        small.paths[1].name = "short";
+        std::vector<uint8_t> expected;
+        REQUIRE(encode(small, expected, encodeOptions(WaypointEncoding::Plain, header)));
+        REQUIRE(patcher.image() == expected);
+        small.paths[1].name = std::string(format::maxNameLength - 1, 'n');
+    }
+
+    // edits near the start of a file with more than 512 MiB after them keep a checksum verify() accepts
+    {
+        std::vector<uint8_t> large;
+        REQUIRE(encode(small, large));
+        large.resize(large.size() + ((size_t)1 << 29) + 8);
+        format::store<uint32_t>(large.data() + format::bodySizeOffset, large.size() - format::fileHeaderSize);
+        format::store(large.data() + format::checksumOffset,
+                      crc32c(large.data() + format::fileHeaderSize, large.size() - format::fileHeaderSize));
+        REQUIRE(patcher.open(std::move(large)));
+
+        w = small.paths[0].waypoints[0];
+        w.x += 1;
+        REQUIRE(patcher.setWaypoint(0, 0, w));
+        REQUIRE(PathFileView(patcher.image().data(), patcher.image().size()).verify());
+        REQUIRE(patcher.rename(0, ""));
+        REQUIRE(PathFileView(patcher.image().data(), patcher.image().size()).verify());
+        patcher.release();
+    }
+}
+
+TEST_CASE("benchmark path file patcher") {
+    PathFile pf = randomPathFile(200, 500, 1500);
+    std::vector<uint8_t> encoded;
+    REQUIRE(encode(pf, encoded));
+
+    BENCHMARK("decode, edit, encode") {
+        PathFile file;
+        decode(encoded.data(), encoded.size(), file);
+        file.paths[100].waypoints[10].speed += 1;
+        return encode(file, encoded);
+    };
+
+    PathFilePatcher patcher;
+    REQUIRE(patcher.open(encoded));
+    Waypoint w = pf.paths[100].waypoints[10];
+    BENCHMARK("patch one waypoint") {
+        w.speed += 1;
+        return patcher.setWaypoint(100, 10, w);
+    };
+    BENCHMARK("rename the first path") { return patcher.rename(0, pf.paths[0].name + "x"); };
+    BENCHMARK("rename the last path") { return patcher.rename(pf.paths.size() - 1, pf.paths.back().name + "x"); };
+    BENCHMARK("append and remove a path") { return patcher.appendPath(pf.paths[0]) && patcher.remove(pf.paths.size()); };
+}
+
+static void requireSamePathFile(const PathFile& a, const PathFile& b) {
+    REQUIRE(a.paths.size() == b.paths.size());
+    for (size_t i = 0; i < a.paths.size(); i++) {
+        REQUIRE(a.paths[i].name == b.paths[i].name);
+        REQUIRE(a.paths[i].waypoints.size() == b.paths[i].waypoints.size());
+        for (size_t j = 0; j < a.paths[i].waypoints.size(); j++)
+            requireSameWaypoint(a.paths[i].waypoints[j], b.paths[i].waypoints[j]);
+    }
+}
+
+TEST_CASE("test delta encoding") {
+    EncodeOptions delta;
+    delta.waypoints = WaypointEncoding::Delta;
+
+    PathFile pf = randomPathFile(30, 0, 300);
+    // differences that wrap around at 16 bits
+    pf.paths[0].waypoints = {{-32768, 32767, -32768, 0, -32768, true, true},
+                             {32767, -32768, 32767, 65535, 32767, true, true},
+                             {0, 0, 0, 0, 0, false, false},
+                             {-1, 1, -1, 1, -1, true, false}};
+
+    std::vector<uint8_t> encoded;
+    REQUIRE(encode(pf, encoded, delta));
+    REQUIRE(encoded.size() == encodedSize(pf, delta));
+    REQUIRE(PathFileView(encoded.data(), encoded.size()).encoding() == WaypointEncoding::Delta);
+
+    PathFile decoded;
+    REQUIRE(decode(encoded.data(), encoded.size(), decoded));
+    requireSamePathFile(decoded, pf);
+    REQUIRE(decodeInto(encoded.data(), encoded.size(), decoded));
+    requireSamePathFile(decoded, pf);
+    PathFile parallel;
+    REQUIRE(decodeParallel(encoded.data(), encoded.size(), parallel, 3));
+    requireSamePathFile(parallel, pf);
+
+    std::vector<uint8_t> other;
+    REQUIRE(encodeParallel(pf, other, 3, delta));
+    REQUIRE(other == encoded);
+    PathFileWriter writer(delta);
+    std::vector<ByteSpan> segments;
+    REQUIRE(writer.segments(pf, segments));
+    other.clear();
+    for (const ByteSpan& span : segments) other.insert(other.end(), span.data, span.data + span.size);
+    REQUIRE(other == encoded);
+
+    LazyPathFile lazy;
+    REQUIRE(lazy.open(encoded.data(), encoded.size()));
+    REQUIRE(lazy.path(17) != nullptr);
+    REQUIRE(lazy.path(17)->waypoints.size() == pf.paths[17].waypoints.size());
+    for (size_t j = 0; j < pf.paths[17].waypoints.size(); j++)
+        requireSameWaypoint(lazy.path(17)->waypoints[j], pf.paths[17].waypoints[j]);
+
+    PathSoAFile soa;
+    REQUIRE(decode(encoded.data(), encoded.size(), soa));
+    for (size_t j = 0; j < pf.paths[5].waypoints.size(); j++)
+        requireSameWaypoint(soa.paths[5].waypoint(j), pf.paths[5].waypoints[j]);
+
+    // skipping part of a path keeps the running values
+    PathCursor paths = PathFileView(encoded.data(), encoded.size()).paths();
+    PathView view;
+    REQUIRE(paths.next(view));
+    REQUIRE(paths.waypoints().skip(2) == 2);
+    Waypoint w;
+    REQUIRE(paths.waypoints().next(w));
+    requireSameWaypoint(w, pf.paths[0].waypoints[2]);
+
+    for (size_t chunk : {1, 5, 64, 100000}) {
+        PathFile pushed;
+        PathFileDecoder decoder([&](Path&& p) { pushed.paths.push_back(std::move(p)); });
+        for (size_t i = 0; i < encoded.size(); i += chunk)
+            decoder.feed(encoded.data() + i, std::min(chunk, encoded.size() - i));
+        REQUIRE(decoder.status() == PathFileDecoder::Status::Done);
+        requireSamePathFile(pushed, pf);
+    }
+
+    // edits that do not depend on earlier records still work
+    PathFilePatcher patcher;
+    REQUIRE(patcher.open(encoded));
+    REQUIRE_FALSE(patcher.setWaypoint(1, 0, pf.paths[1].waypoints[0]));
+    REQUIRE(patcher.appendPath(pf.paths[3]));
+    REQUIRE(patcher.rename(2, "renamed"));
+    pf.paths.push_back(pf.paths[3]);
+    pf.paths[2].name = "renamed";
+    REQUIRE(encode(pf, other, delta));
+    REQUIRE(patcher.image() == other);
+
+    // truncated records are an error, not garbage
+    for (size_t size : {encoded.size() - 1, encoded.size() / 2}) {
+        PathFile truncated;
+        REQUIRE_FALSE(decode(encoded.data(), size, truncated));
+        PathFileDecoder decoder([](Path&&) {});
+        REQUIRE(decoder.feed(encoded.data(), size) != PathFileDecoder::Status::Done);
+    }
+
+    // an encoding this version does not know is refused
+    delta.header = false;
+    REQUIRE(encode(pf, encoded, delta));
+    encoded[3] = 2;
+    REQUIRE_FALSE(decode(encoded.data(), encoded.size(), decoded));
+    PathFileDecoder decoder([](Path&&) {});
+    REQUIRE(decoder.feed(encoded.data(), encoded.size()) == PathFileDecoder::Status::Error);
+
+    // headerless plain files are written exactly as before
+    REQUIRE(encode(pf, encoded, encodeOptions(WaypointEncoding::Plain, false)));
+    std::vector<uint8_t> reference(encoded.size());
+    size_t referenceSize = reference.size();
+    REQUIRE(encodeUsingStream(pf, reference.data(), referenceSize));
+    REQUIRE(reference == encoded);
+}
+
+TEST_CASE("benchmark delta encoding") {
+    EncodeOptions delta;
+    delta.waypoints = WaypointEncoding::Delta;
+
+    const std::pair<const char*, PathFile> corpora[] = {{"smooth", smoothPathFile(200, 1000)},
+                                                        {"random", randomPathFile(200, 1000, 1000)}};
+    for (const auto& [name, pf] : corpora) {
+        std::vector<uint8_t> plain, compact;
+        REQUIRE(encode(pf, plain));
+        REQUIRE(encode(pf, compact, delta));
+
+        PathFile out;
+        const double plainRate =
+            gigabytesPerSecond(plain.size(), 20, [&] { decodeInto(plain.data(), plain.size(), out); });
+        const double deltaRate =
+            gigabytesPerSecond(compact.size(), 20, [&] { decodeInto(compact.data(), compact.size(), out); });
+        // the same waypoints per second in both layouts
+        const double waypoints = 200.0 * 1000.0;
+        std::cout << name << " paths: plain " << plain.size() << " bytes, delta " << compact.size() << " bytes, ratio "
+                  << (double)plain.size() / compact.size() << "; decode plain " << plainRate << " GB/s ("
+                  << plainRate * 1e9 / plain.size() * waypoints / 1e6 << " M waypoints/s), delta " << deltaRate
+                  << " GB/s (" << deltaRate * 1e9 / compact.size() * waypoints / 1e6 << " M waypoints/s)"
+                  << std::endl;
+    }
+
+    PathFile pf = smoothPathFile(200, 1000);
+    std::vector<uint8_t> compact;
+    REQUIRE(encode(pf, compact, delta));
+    BENCHMARK("encode delta") { return encode(pf, compact, delta); };
+    PathFile out;
+    BENCHMARK("decode delta") { return decodeInto(compact.data(), compact.size(), out); };
+}
+
+TEST_CASE("test file header") {
+    const std::string check = "123456789";
+    REQUIRE(crc32c(reinterpret_cast<const uint8_t*>(check.data()), check.size()) == 0xE3069283);
+    std::vector<uint8_t> random(100000);
+    for (uint8_t& b : random) b = rand();
+    for (size_t size : {0, 1, 7, 8, 9, 12287, 12288, 12289, 40000, 100000}) {
+        const uint32_t crc = crc32c(random.data(), size);
+        REQUIRE(crc == crc32cSoftware(random.data(), size));
+        REQUIRE(crc == crc32cCombine(crc32c(random.data(), size / 3), crc32c(random.data() + size / 3, size - size / 3),
+                                     size - size / 3));
+        // replacing the last third by a tail of any length, from the checksums of the tails alone
+        const size_t kept = size - size / 3;
+        for (size_t newSize : {(size_t)0, size / 3, size / 2, size}) {
+            const uint32_t replaced =
+                crc32cReplaceTail(crc, crc32c(random.data() + kept, size - kept), size - kept,
+                                  crc32c(random.data(), newSize), newSize);
+            std::vector<uint8_t> message(random.begin(), random.begin() + kept);
+            message.insert(message.end(), random.begin(), random.begin() + newSize);
+            REQUIRE(replaced == crc32c(message.data(), message.size()));
+        }
+    }
+    // lengths of 2^29 bytes and more move the checksum by x^(2^32) and beyond, checked against a direct checksum
+    // of zero bytes continued from a small reused buffer
+    const std::vector<uint8_t> zeros(1 << 16);
+    const auto continueWithZeros = [&](uint32_t crc, size_t size) {
+        for (size_t done = 0; done < size; done += zeros.size())
+            crc = crc32c(zeros.data(), std::min(zeros.size(), size - done), crc);
+        return crc;
+    };
+    for (size_t size : {((size_t)1 << 29) + 8, ((size_t)1 << 30) + 16}) {
+        const uint32_t head = crc32c(random.data(), 1000);
+        const uint32_t tail = continueWithZeros(0, size);
+        const uint32_t direct = continueWithZeros(head, size);
+        REQUIRE(crc32cCombine(head, tail, size) == direct);
+        REQUIRE(crc32cReplaceTail(head, 0, 0, tail, size) == direct);
+        REQUIRE(crc32cReplaceTail(direct, tail, size, crc32c(random.data(), 10), 10) ==
+                crc32c(random.data(), 10, head));
+        // flipping the first byte, with all of the zero bytes after it
+        const uint8_t diff = 0x5A;
+        const uint8_t first = random[0] ^ diff;
+        const uint32_t patched = continueWithZeros(crc32c(random.data() + 1, 999, crc32c(&first, 1)), size);
+        REQUIRE(crc32cPatch(direct, &diff, 1, 999 + size) == patched);
+    }
+
+    PathFile pf = randomPathFile(20, 0, 300);
+    std::vector<uint8_t> encoded;
+    REQUIRE(encode(pf, encoded));
+    REQUIRE(memcmp(encoded.data(), format::magic, sizeof(format::magic)) == 0);
+
+    PathFileView view(encoded.data(), encoded.size());
+    REQUIRE(view.valid());
+    REQUIRE(view.hasHeader());
+    REQUIRE(view.version() == format::version);
+    REQUIRE(view.body().size == encoded.size() - format::fileHeaderSize);
+    REQUIRE(view.verify());
+
+    // files without the header are still read
+    std::vector<uint8_t> headerless;
+    REQUIRE(encode(pf, headerless, encodeOptions(WaypointEncoding::Plain, false)));
+    PathFile decoded;
+    REQUIRE(decode(headerless.data(), headerless.size(), decoded));
+    REQUIRE_FALSE(PathFileView(headerless.data(), headerless.size()).hasHeader());
+    REQUIRE(PathFileView(headerless.data(), headerless.size()).verify());
+
+    // bytes after the body are not part of the file
+    std::vector<uint8_t> padded = encoded;
+    padded.push_back(0xAB);
+    decoded.paths.clear();
+    REQUIRE(decode(padded.data(), padded.size(), decoded));
+    requireSamePathFile(decoded, pf);
+
+    // a truncated file fails fast, a flipped bit anywhere in the body fails the checksum
+    REQUIRE_FALSE(decode(encoded.data(), encoded.size() - 1, decoded));
+    for (size_t offset : {format::fileHeaderSize, encoded.size() / 2, encoded.size() - 1}) {
+        std::vector<uint8_t> corrupt = encoded;
+        corrupt[offset] ^= 0x10;
+        REQUIRE(PathFileView(corrupt.data(), corrupt.size()).valid());
+        REQUIRE_FALSE(PathFileView(corrupt.data(), corrupt.size()).verify());
+        REQUIRE_FALSE(decode(corrupt.data(), corrupt.size(), decoded));
+        REQUIRE_FALSE(decodeInto(corrupt.data(), corrupt.size(), decoded));
+        REQUIRE_FALSE(decodeParallel(corrupt.data(), corrupt.size(), decoded, 2));
+        LazyPathFile lazy;
+        REQUIRE_FALSE(lazy.open(corrupt.data(), corrupt.size()));
+        PathFileDecoder decoder([](Path&&) {});
+        REQUIRE(decoder.feed(corrupt.data(), corrupt.size()) == PathFileDecoder::Status::Error);
+    }
+
+    // versions this one does not know are refused
+    std::vector<uint8_t> future = encoded;
+    future[format::versionOffset] = format::version + 1;
+    REQUIRE_FALSE(PathFileView(future.data(), future.size()).valid());
+    PathFileDecoder futureDecoder([](Path&&) {});
+    REQUIRE(futureDecoder.feed(future.data(), future.size()) == PathFileDecoder::Status::Error);
+
+    // the push decoder waits for the whole body before it reports Done
+    for (size_t chunk : {1, 3, 16, 17, 1000}) {
+        PathFile pushed;
+        PathFileDecoder decoder([&](Path&& p) { pushed.paths.push_back(std::move(p)); });
+        for (size_t i = 0; i < padded.size(); i += chunk) {
+            PathFileDecoder::Status status = decoder.feed(padded.data() + i, std::min(chunk, padded.size() - i));
+            REQUIRE(status == (i + chunk >= encoded.size() ? PathFileDecoder::Status::Done
+                                                           : PathFileDecoder::Status::NeedMoreData));
+        }
+        requireSamePathFile(pushed, pf);
+    }
+
+    // every encoder writes the same header
+    std::vector<uint8_t> other;
+    REQUIRE(encodeParallel(pf, other, 3));
+    REQUIRE(other == encoded);
+    PathFileWriter writer;
+    std::vector<ByteSpan> segments;
+    REQUIRE(writer.segments(pf, segments));
+    other.clear();
+    for (const ByteSpan& span : segments) other.insert(other.end(), span.data, span.data + span.size);
+    REQUIRE(other == encoded);
+    const TemporaryFile temporary("testFileHeader.bin");
+    const char* fileName = temporary.name();
+    FILE* file = fopen(fileName, "wb");
+    REQUIRE(file != nullptr);
+    REQUIRE(encodeToFile(pf, fileno(file)));
+    fclose(file);
+    REQUIRE(readFile(fileName) == encoded);
+
+    // the sealed header goes where the file started, also behind other bytes, and files that cannot take it back
+    // get the same bytes in one go: O_APPEND and a pipe
+    const size_t prefixSize = 3;
+    std::vector<uint8_t> prefixed(prefixSize + encoded.size(), 0xAB);
+    std::copy(encoded.begin(), encoded.end(), prefixed.begin() + prefixSize);
+    for (const char* mode : {"wb", "ab"}) {
+        remove(fileName);
+        file = fopen(fileName, mode);
+        REQUIRE(file != nullptr);
+        REQUIRE(fwrite(prefixed.data(), 1, prefixSize, file) == prefixSize);
+        fflush(file);
+        REQUIRE(encodeToFile(pf, fileno(file)));
+        fclose(file);
+        REQUIRE(readFile(fileName) == prefixed);
+    }
+    const std::string command = std::string("cat > '") + fileName + "'";
+    file = popen(command.c_str(), "w");
+    REQUIRE(file != nullptr);
+    REQUIRE(encodeToFile(pf, fileno(file)));
+    REQUIRE(pclose(file) == 0);
+    REQUIRE(readFile(fileName) == encoded);
+
+    // patched files keep a valid checksum
+    PathFilePatcher patcher;
+    REQUIRE(patcher.open(encoded));
+    Waypoint w = pf.paths[4].waypoints[0];
+    w.x += 1;
+    REQUIRE(patcher.setWaypoint(4, 0, w));
+    pf.paths[4].waypoints[0] = w;
+    REQUIRE(encode(pf, other));
+    REQUIRE(patcher.image() == other);
+    REQUIRE(patcher.rename(1, "longer name"));
+    REQUIRE(patcher.remove(2));
+    REQUIRE(patcher.appendPath(pf.paths[0]));
+    REQUIRE(PathFileView(patcher.image().data(), patcher.image().size()).verify());
+}
+
+TEST_CASE("benchmark file header") {
+    std::vector<uint8_t> buf(64 * 1024 * 1024);
+    for (size_t i = 0; i < buf.size(); i++) buf[i] = i * 2654435761u >> 24;
+    const double best = gigabytesPerSecond(buf.size(), 10, [&] { crc32c(buf.data(), buf.size()); });
+    const double tables = gigabytesPerSecond(buf.size(), 3, [&] { crc32cSoftware(buf.data(), buf.size()); });
+    std::cout << "crc32c (" << (isCrc32cAccelerated() ? "sse4.2" : "tables") << "): " << best
+              << " GB/s, slicing-by-8: " << tables << " GB/s" << std::endl;
+
+    PathFile pf = randomPathFile(2000, 500, 1500);
+    std::vector<uint8_t> encoded;
+    REQUIRE(encode(pf, encoded));
+    PathFileView view(encoded.data(), encoded.size());
+    BENCHMARK("verify") { return view.verify(); };
+    PathFile out;
+    BENCHMARK("decodeInto with header") { return decodeInto(encoded.data(), encoded.size(), out); };
+    REQUIRE(encode(pf, encoded, encodeOptions(WaypointEncoding::Plain, false)));
+    BENCHMARK("decodeInto without header") { return decodeInto(encoded.data(), encoded.size(), out); };
+}
+
+TEST_CASE("test metadata") {
+    PathFile pf = randomPathFile(10, 0, 100);
+    REQUIRE(appendMetadata(pf.metadata, 0x10, uint32_t(1500)));
+    REQUIRE(appendMetadata(pf.metadata, 0x11, "field", 5));
+    REQUIRE(appendMetadata(pf.paths[3].metadata, 0x20, 0.25f));
+    REQUIRE(appendMetadata(pf.paths[3].metadata, 0x21, nullptr, 0));
+    std::pmr::vector<uint8_t> full;
+    REQUIRE(appendMetadata(full, 0x01, std::vector<uint8_t>(253).data(), 253));
+    REQUIRE_FALSE(appendMetadata(full, 0x02, uint8_t(0)));
+    REQUIRE(full.size() == 255);
+
+    for (WaypointEncoding encoding : {WaypointEncoding::Plain, WaypointEncoding::Delta}) {
+        EncodeOptions options;
+        options.waypoints = encoding;
+        std::vector<uint8_t> encoded;
+        REQUIRE(encode(pf, encoded, options));
+
+        // the view hands out the blocks in place; the encoding entry is only hidden when decoding
+        PathFileView view(encoded.data(), encoded.size());
+        REQUIRE(view.valid());
+        REQUIRE(view.encoding() == encoding);
+        uint32_t timeout = 0;
+        REQUIRE(findMetadata(view.metadata(), 0x10, timeout));
+        REQUIRE(timeout == 1500);
+        float gain = 0;
+        REQUIRE_FALSE(findMetadata(view.metadata(), 0x11, gain));
+        PathCursor paths = view.paths();
+        PathView p;
+        for (int i = 0; i <= 3; i++) REQUIRE(paths.next(p));
+        REQUIRE(findMetadata(p.metadata(), 0x20, gain));
+        REQUIRE(gain == 0.25f);
+        ByteSpan value;
+        REQUIRE(findMetadata(p.metadata(), 0x21, value));
+        REQUIRE(value.size == 0);
+        REQUIRE_FALSE(findMetadata(p.metadata(), 0x22, value));
+
+        PathFile decoded;
+        REQUIRE(decode(encoded.data(), encoded.size(), decoded));
+        requireSamePathFile(decoded, pf);
+        REQUIRE(decoded.metadata == pf.metadata);
+        for (size_t i = 0; i < pf.paths.size(); i++) REQUIRE(decoded.paths[i].metadata == pf.paths[i].metadata);
+        REQUIRE(decodeInto(encoded.data(), encoded.size(), decoded));
+        REQUIRE(decoded.metadata == pf.metadata);
+        PathFile parallel;
+        REQUIRE(decodeParallel(encoded.data(), encoded.size(), parallel, 2));
+        REQUIRE(parallel.metadata == pf.metadata);
+        REQUIRE(parallel.paths[3].metadata == pf.paths[3].metadata);
+
+        PathFile pushed;
+        PathFileDecoder decoder([&](Path&& path) { pushed.paths.push_back(std::move(path)); });
+        for (size_t i = 0; i < encoded.size(); i += 7)
+            decoder.feed(encoded.data() + i, std::min<size_t>(7, encoded.size() - i));
+        REQUIRE(decoder.status() == PathFileDecoder::Status::Done);
+        REQUIRE(pushed.paths[3].metadata == pf.paths[3].metadata);
+        REQUIRE(findMetadata(decoder.metadata(), 0x10, timeout));
+
+        // every encoder writes the same bytes
+        std::vector<uint8_t> other;
+        REQUIRE(encodeParallel(pf, other, 3, options));
+        REQUIRE(other == encoded);
+        PathFileWriter writer(options);
+        std::vector<ByteSpan> segments;
+        REQUIRE(writer.segments(pf, segments));
+        other.clear();
+        for (const ByteSpan& span : segments) other.insert(other.end(), span.data, span.data + span.size);
+        REQUIRE(other == encoded);
+        PathSoAFile soa;
+        REQUIRE(decode(encoded.data(), encoded.size(), soa));
+        REQUIRE(soa.paths[3].metadata == std::vector<uint8_t>(pf.paths[3].metadata.begin(), pf.paths[3].metadata.end()));
+
+        // a changed metadata block is noticed by the writer without invalidate()
+        PathFile edited = pf;
+        REQUIRE(appendMetadata(edited.paths[5].metadata, 0x30, uint8_t(1)));
+        REQUIRE(writer.segments(edited, segments));
+        REQUIRE(writer.encodedPaths() == 1);
+
+        PathFilePatcher patcher;
+        REQUIRE(patcher.open(encoded));
+        REQUIRE(patcher.appendPath(pf.paths[3]));
+        if (encoding == WaypointEncoding::Plain)
+            REQUIRE(patcher.setWaypoint(pf.paths.size(), 0, pf.paths[3].waypoints[0]));
+        decoded.paths.clear();
+        REQUIRE(decode(patcher.image().data(), patcher.image().size(), decoded));
+        REQUIRE(decoded.paths.back().metadata == pf.paths[3].metadata);
+    }
+
+    // the encoding entry belongs to the encoder, and blocks have a size byte
+    PathFile bad = pf;
+    REQUIRE(appendMetadata(bad.metadata, format::waypointEncodingTag, uint8_t(1)));
+    std::vector<uint8_t> encoded;
+    REQUIRE_FALSE(encode(bad, encoded));
+    bad = pf;
+    bad.paths[0].metadata.resize(256);
+    REQUIRE_FALSE(encode(bad, encoded));
+    bad = pf;
+    bad.metadata.resize(253);
+    REQUIRE(encode(bad, encoded));
+    REQUIRE_FALSE(encode(bad, encoded, encodeOptions(WaypointEncoding::Delta)));
+
+    // metadata from before the entries existed is kept as it is
+    bad = pf;
+    bad.metadata = {0x10, 0x05, 0x00};
+    REQUIRE(encode(bad, encoded));
+    PathFile decoded;
+    REQUIRE(decode(encoded.data(), encoded.size(), decoded));
+    REQUIRE(decoded.metadata == bad.metadata);
+    MetadataReader reader(PathFileView(encoded.data(), encoded.size()).metadata());
+    MetadataEntry entry;
+    REQUIRE_FALSE(reader.next(entry));
+    REQUIRE(reader.failed());
+}
+
+TEST_CASE("benchmark metadata") {
+    // files without metadata decode as fast as before, and files with it only pay for copying the blocks
+    PathFile pf = randomPathFile(2000, 500, 1500);
+    std::vector<uint8_t> plain, tagged;
+    REQUIRE(encode(pf, plain));
+    for (Path& p : pf.paths) REQUIRE(appendMetadata(p.metadata, 0x20, std::vector<uint8_t>(64).data(), 64));
+    REQUIRE(appendMetadata(pf.metadata, 0x10, std::vector<uint8_t>(200).data(), 200));
+    REQUIRE(encode(pf, tagged));
+
+    PathFile out;
+    BENCHMARK("decodeInto without metadata") { return decodeInto(plain.data(), plain.size(), out); };
+    BENCHMARK("decodeInto with metadata") { return decodeInto(tagged.data(), tagged.size(), out); };
+    PathFileView view(tagged.data(), tagged.size());
+    BENCHMARK("find a path metadata entry in place") {
+        PathCursor paths = view.paths();
+        PathView p;
+        size_t found = 0;
+        ByteSpan value;
+        while (paths.next(p)) found += findMetadata(p.metadata(), 0x20, value);
+        return found;
+    };
+}
+
+TEST_CASE("test editor data") {
+    PathFile pf = randomPathFile(10, 0, 100);
+    std::vector<uint8_t> blob(5000);
+    for (uint8_t& b : blob) b = rand();
+
+    for (WaypointEncoding encoding : {WaypointEncoding::Plain, WaypointEncoding::Delta}) {
+        for (bool header : {true, false}) {
+            EncodeOptions options = encodeOptions(encoding, header);
+            std::vector<uint8_t> bare;
+            REQUIRE(encode(pf, bare, options));
+            REQUIRE(PathFileView(bare.data(), bare.size()).editorData().size == 0);
+
+            options.editorData = {blob.data(), blob.size()};
+            std::vector<uint8_t> encoded;
+            REQUIRE(encode(pf, encoded, options));
+            REQUIRE(encoded.size() == bare.size() + blob.size());
+            REQUIRE(encodedSize(pf, options) == encoded.size());
+
+            PathFileView view(encoded.data(), encoded.size());
+            REQUIRE(view.verify());
+            ByteSpan editor = view.editorData();
+            REQUIRE(editor.data == encoded.data() + bare.size());
+            REQUIRE(editor.size == blob.size());
+            REQUIRE(memcmp(editor.data, blob.data(), blob.size()) == 0);
+            LazyPathFile lazy;
+            REQUIRE(lazy.open(encoded.data(), encoded.size()));
+            REQUIRE(lazy.editorData().data == editor.data);
+            REQUIRE(lazy.editorData().size == editor.size);
+
+            // loading ignores it
+            PathFile decoded;
+            REQUIRE(decode(encoded.data(), encoded.size(), decoded));
+            requireSamePathFile(decoded, pf);
+
+            // saving it again, by every encoder, gives the same file
+            std::vector<uint8_t> other;
+            options.editorData = editor;
+            REQUIRE(encode(decoded, other, options));
+            REQUIRE(other == encoded);
+            REQUIRE(encodeParallel(pf, other, 3, options));
+            REQUIRE(other == encoded);
+            PathFileWriter writer(options);
+            std::vector<ByteSpan> segments;
+            REQUIRE(writer.segments(pf, segments));
+            other.clear();
+            for (const ByteSpan& span : segments) other.insert(other.end(), span.data, span.data + span.size);
+            REQUIRE(other == encoded);
+            const TemporaryFile temporary("testEditorData.bin");
+            const char* fileName = temporary.name();
+            FILE* file = fopen(fileName, "wb");
+            REQUIRE(file != nullptr);
+            REQUIRE(encodeToFile(pf, fileno(file), options));
+            fclose(file);
+            REQUIRE(readFile(fileName) == encoded);
+            PathSoAFile soa;
+            REQUIRE(decode(encoded.data(), encoded.size(), soa));
+            other.resize(encoded.size());
+            size_t size = other.size();
+            REQUIRE(encode(soa, other.data(), size, options));
+            REQUIRE(other == encoded);
+            size = other.size() - 1;
+            REQUIRE_FALSE(encode(soa, other.data(), size, options));
+
+            // the patcher keeps it behind the paths
+            PathFilePatcher patcher;
+            REQUIRE(patcher.open(encoded));
+            REQUIRE(patcher.appendPath(pf.paths[0]));
+            REQUIRE(patcher.remove(0));
+            ByteSpan patched = PathFileView(patcher.image().data(), patcher.image().size()).editorData();
+            REQUIRE(patched.size == blob.size());
+            REQUIRE(memcmp(patched.data, blob.data(), blob.size()) == 0);
+
+            // a path running past the end leaves no editor data to find
+            std::vector<uint8_t> truncated(bare.begin(), bare.end() - 1);
+            REQUIRE(PathFileView(truncated.data(), truncated.size()).editorData().data == nullptr);
+        }
+    }
+}
+
+TEST_CASE("benchmark editor data") {
+    // a megabyte of editor history behind the paths
+    PathFile pf = randomPathFile(200, 500, 1500);
+    std::vector<uint8_t> blob(1024 * 1024, 0x5A);
+    EncodeOptions options;
+    options.editorData = {blob.data(), blob.size()};
+    std::vector<uint8_t> bare, encoded;
+    REQUIRE(encode(pf, bare));
+    REQUIRE(encode(pf, encoded, options));
+
+    PathFile out;
+    BENCHMARK("decodeInto without editor data") { return decodeInto(bare.data(), bare.size(), out); };
+    // the only cost is the checksum of the extra megabyte
+    BENCHMARK("decodeInto with 1 MB of editor data") { return decodeInto(encoded.data(), encoded.size(), out); };
+    PathFileView view(encoded.data(), encoded.size());
+    BENCHMARK("find the editor data, plain layout") { return view.editorData().size; };
+    options.waypoints = WaypointEncoding::Delta;
+    std::vector<uint8_t> delta;
+    REQUIRE(encode(pf, delta, options));
+    PathFileView deltaView(delta.data(), delta.size());
+    BENCHMARK("find the editor data, delta layout") { return deltaView.editorData().size; };
+}
+
+// gives every stride-th waypoint a random set of unknown parameters
+static void addUnknownParameters(PathFile& pf, int stride) {
+    for (Path& p : pf.paths) {
+        for (size_t i = 0; i < p.waypoints.size(); i += stride) {
+            UnknownParameters u = {};
+            u.waypoint = i;
+            while (u.flags == 0) u.flags = rand() & format::unknownFlags;
+            for (uint16_t& v : u.values) v = rand();
+            p.unknownParameters.push_back(u);
+        }
+    }
+}
+
+static void requireSameUnknownParameters(const Path& a, const Path& b) {
+    REQUIRE(a.unknownParameters.size() == b.unknownParameters.size());
+    for (size_t i = 0; i < a.unknownParameters.size(); i++) {
+        const UnknownParameters& x = a.unknownParameters[i];
+        const UnknownParameters& y = b.unknownParameters[i];
+        REQUIRE(x.waypoint == y.waypoint);
+        REQUIRE(x.flags == y.flags);
+        for (size_t j = 0; j < format::parameterCount(x.flags); j++) REQUIRE(x.values[j] == y.values[j]);
+    }
+}
+
+TEST_CASE("test unknown parameters") {
+    // a record written by a newer editor: heading, then the parameters of bits 0x04 and 0x80
+    const std::vector<uint8_t> file = {0, 1, 0, 'a', 0, 0, 2, 0, 0, 0,
+                                       0x85, 1, 0, 2, 0, 3, 0, 4, 0, 0x34, 0x12, 0xCD, 0xAB,
+                                       0x00, 5, 0, 6, 0, 7, 0};
+    PathFile decoded;
+    REQUIRE(decode(file.data(), file.size(), decoded));
+    REQUIRE(decoded.paths[0].waypoints.size() == 2);
+    REQUIRE(decoded.paths[0].waypoints[0].heading == 4);
+    REQUIRE(decoded.paths[0].unknownParameters.size() == 1);
+    const UnknownParameters& u = decoded.paths[0].unknownParameters[0];
+    REQUIRE(u.waypoint == 0);
+    REQUIRE(u.flags == 0x84);
+    REQUIRE(u.values[0] == 0x1234);
+    REQUIRE(u.values[1] == 0xABCD);
+    std::vector<uint8_t> encoded;
+    REQUIRE(encode(decoded, encoded, encodeOptions(WaypointEncoding::Plain, false)));
+    REQUIRE(encoded == file);
+
+    PathFile pf = randomPathFile(20, 0, 300);
+    addUnknownParameters(pf, 7);
+    for (WaypointEncoding encoding : {WaypointEncoding::Plain, WaypointEncoding::Delta}) {
+        EncodeOptions options;
+        options.waypoints = encoding;
+        REQUIRE(encode(pf, encoded, options));
+        REQUIRE(encodedSize(pf, options) == encoded.size());
+
+        // every decoder keeps them and every encoder writes them back bit-exactly
+        std::vector<PathFile> outputs(4);
+        REQUIRE(decode(encoded.data(), encoded.size(), outputs[0]));
+        REQUIRE(decodeInto(encoded.data(), encoded.size(), outputs[1]));
+        REQUIRE(decodeParallel(encoded.data(), encoded.size(), outputs[2], 3));
+        PathFileDecoder decoder([&](Path&& p) { outputs[3].paths.push_back(std::move(p)); });
+        for (size_t i = 0; i < encoded.size(); i += 5)
+            decoder.feed(encoded.data() + i, std::min<size_t>(5, encoded.size() - i));
+        REQUIRE(decoder.status() == PathFileDecoder::Status::Done);
+        for (const PathFile& out : outputs) {
+            requireSamePathFile(out, pf);
+            for (size_t i = 0; i < pf.paths.size(); i++) requireSameUnknownParameters(out.paths[i], pf.paths[i]);
+            std::vector<uint8_t> again;
+            REQUIRE(encode(out, again, options));
+            REQUIRE(again == encoded);
+        }
+        LazyPathFile lazy;
+        REQUIRE(lazy.open(encoded.data(), encoded.size()));
+        requireSameUnknownParameters(*lazy.path(3), pf.paths[3]);
+
+        PathSoAFile soa;
+        REQUIRE(decode(encoded.data(), encoded.size(), soa));
+        Path fromSoA;
+        toPath(soa.paths[3], fromSoA);
+        requireSameUnknownParameters(fromSoA, pf.paths[3]);
+        std::vector<uint8_t> again(encoded.size());
+        size_t size = again.size();
+        REQUIRE(encode(soa, again.data(), size, options));
+        REQUIRE(again == encoded);
+
+        std::vector<uint8_t> parallel;
+        REQUIRE(encodeParallel(pf, parallel, 3, options));
+        REQUIRE(parallel == encoded);
+    }
+
+    // patching a waypoint leaves its unknown parameters alone
+    REQUIRE(encode(pf, encoded));
+    PathFilePatcher patcher;
+    REQUIRE(patcher.open(encoded));
+    Waypoint w = pf.paths[2].waypoints[7];
+    w.x += 1;
+    REQUIRE(patcher.setWaypoint(2, 7, w));
+    decoded.paths.clear();
+    REQUIRE(decode(patcher.image().data(), patcher.image().size(), decoded));
+    REQUIRE(decoded.paths[2].waypoints[7].x == w.x);
+    requireSameUnknownParameters(decoded.paths[2], pf.paths[2]);
+
+    // tables the encoder could not write back are refused
+    Path p = pf.paths[0];
+    p.unknownParameters = {{0, 0x04, {1}}, {0, 0x08, {2}}};
+    REQUIRE(encode(p, encoded.data()) == nullptr);
+    p.unknownParameters = {{1, 0x04, {1}}, {0, 0x08, {2}}};
+    REQUIRE(encode(p, encoded.data()) == nullptr);
+    p.unknownParameters = {{0, 0x05, {1}}};
+    REQUIRE(encode(p, encoded.data()) == nullptr);
+    p.unknownParameters = {{0, 0, {}}};
+    REQUIRE(encode(p, encoded.data()) == nullptr);
+    p.unknownParameters = {{(uint32_t)p.waypoints.size(), 0x04, {1}}};
+    REQUIRE(encode(p, encoded.data()) == nullptr);
+
+    // a malformed delta field stops reading the parameters, the rest stay 0
+    const uint8_t record[] = {0x0C, 0, 0, 0, 6, 0xFF, 0xFF, 0x7F, 0, 0};
+    const UnknownParameters malformed = loadUnknownParameters(record, WaypointEncoding::Delta, 9);
+    REQUIRE(malformed.waypoint == 9);
+    REQUIRE(malformed.flags == 0x0C);
+    REQUIRE(malformed.values[0] == 3);
+    REQUIRE(malformed.values[1] == 0);
+}
+
+TEST_CASE("benchmark unknown parameters") {
+    // paths without unknown parameters should decode as fast as before the side table existed
+    PathFile empty = randomPathFile(200, 500, 1500);
+    PathFile dense = empty;
+    addUnknownParameters(dense, 1);
+    PathFile out;
+
+    for (WaypointEncoding encoding : {WaypointEncoding::Plain, WaypointEncoding::Delta}) {
+        const std::string layout = encoding == WaypointEncoding::Plain ? ", plain" : ", delta";
+        EncodeOptions options;
+        options.waypoints = encoding;
+        std::vector<uint8_t> emptyFile, denseFile;
+        REQUIRE(encode(empty, emptyFile, options));
+        REQUIRE(encode(dense, denseFile, options));
+        BENCHMARK("decodeInto without unknown parameters" + layout) {
+            return decodeInto(emptyFile.data(), emptyFile.size(), out);
+        };
+        BENCHMARK("decodeInto with unknown parameters on every waypoint" + layout) {
+            return decodeInto(denseFile.data(), denseFile.size(), out);
+        };
+        BENCHMARK("encode without unknown parameters" + layout) { return encode(empty, emptyFile, options); };
+        BENCHMARK("encode with unknown parameters on every waypoint" + layout) {
+            return encode(dense, denseFile, options);
+        };
+    }
+}
+
+// the size of a record by testing the flag bits one after another, as the decoder did before the layout table
+static size_t recordSizeByBits(uint8_t flag) {
+    size_t size = format::waypointHeaderSize;
+    for (int bit = 0; bit < 8; bit++)
+        if (flag & (1 << bit)) size += 2;
+    return size;
+}
+
+// count records with random flag bytes, unknown parameters included
+static std::vector<uint8_t> randomRecords(size_t count) {
+    std::vector<uint8_t> records;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t flag = rand();
+        records.push_back(flag);
+        for (size_t j = 1; j < recordSizeByBits(flag); j++) records.push_back(rand());
+    }
+    return records;
+}
+
+TEST_CASE("test record layout table") {
+    static_assert(format::recordSize(0x00) == 7);
+    static_assert(format::recordSize(0xFF) == 23);
+    static_assert(format::recordLayout(0x03).heading == 7 && format::recordLayout(0x03).lookahead == 9);
+    static_assert(format::recordLayout(0x02).heading == 0 && format::recordLayout(0x02).lookahead == 7);
+    static_assert(format::recordLayout(0x85).unknown[0] == 9 && format::recordLayout(0x85).unknown[5] == 11);
+
+    for (unsigned flag = 0; flag < 256; flag++) {
+        const format::RecordLayout& layout = format::recordLayout(flag);
+        REQUIRE(layout.size == recordSizeByBits(flag));
+        REQUIRE(layout.fields == 3 + (layout.size - 7) / 2);
+        // the offsets of the present fields follow the speed in bit order
+        size_t offset = format::waypointHeaderSize;
+        const uint8_t offsets[8] = {layout.heading,    layout.lookahead,  layout.unknown[0], layout.unknown[1],
+                                    layout.unknown[2], layout.unknown[3], layout.unknown[4], layout.unknown[5]};
+        for (int bit = 0; bit < 8; bit++) {
+            if (flag & (1 << bit)) {
+                REQUIRE(offsets[bit] == offset);
+                offset += 2;
+            } else {
+                REQUIRE(offsets[bit] == 0);
+            }
+        }
+    }
+
+    // skipping stops before a record that runs past the end, wherever the end is
+    const std::vector<uint8_t> records = randomRecords(200);
+    std::vector<size_t> starts = {0};
+    while (starts.back() < records.size()) starts.push_back(starts.back() + recordSizeByBits(records[starts.back()]));
+    for (size_t size = 0; size <= records.size(); size += 7) {
+        const size_t whole = std::upper_bound(starts.begin(), starts.end(), size) - starts.begin() - 1;
+        for (size_t n : {(size_t)0, (size_t)1, whole / 2, whole, whole + 1, (size_t)1000}) {
+            const uint8_t* ptr = records.data();
+            const size_t skipped = format::skipWaypoints(ptr, records.data() + size, n);
+            REQUIRE(skipped == std::min(n, whole));
+            REQUIRE(ptr == records.data() + starts[skipped]);
+        }
+    }
+
+    // absent fields decode as 0
+    const uint8_t record[] = {0x00, 1, 0, 2, 0, 3, 0};
+    WaypointCursor cursor(record, record + sizeof(record), 1);
+    Waypoint w;
+    w.heading = 5;
+    w.lookahead = 6;
+    REQUIRE(cursor.next(w));
+    REQUIRE(w.heading == 0);
+    REQUIRE(w.lookahead == 0);
+}
+
+TEST_CASE("benchmark skip scan") {
+    const size_t count = 1000000;
+    const std::vector<uint8_t> records = randomRecords(count);
+    const uint8_t* end = records.data() + records.size();
+
+    BENCHMARK("skip 1M records, flag bits tested one by one") {
+        const uint8_t* p = records.data();
+        for (size_t i = 0; i < count; i++) p += recordSizeByBits(*p);
+        return p;
+    };
+    BENCHMARK("skip 1M records, layout table") {
+        const uint8_t* p = records.data();
+        return format::skipWaypoints(p, end, count);
+    };
+    BENCHMARK("skip 1M records, WaypointCursor") {
+        WaypointCursor cursor(records.data(), end, count);
+        return cursor.skip(count);
+    };
+
+    PathFile pf = randomPathFile(200, 500, 1500);
+    std::vector<uint8_t> encoded;
+    REQUIRE(encode(pf, encoded));
+    PathFileView view(encoded.data(), encoded.size());
+    BENCHMARK("scan the paths of a file") {
+        std::vector<PathIndexEntry> index;
+        return scan(encoded.data(), encoded.size(), index);
+    };
+    BENCHMARK("find the editor data of a file") { return view.editorData().size; };
+}
+
+TEST_CASE("test validate") {
+    PathFile pf = randomPathFile(5, 0, 40);
+    addUnknownParameters(pf, 5);
+    REQUIRE(appendMetadata(pf.paths[1].metadata, 0x20, uint16_t(7)));
+
+    for (WaypointEncoding encoding : {WaypointEncoding::Plain, WaypointEncoding::Delta}) {
+        for (bool header : {true, false}) {
+            std::vector<uint8_t> encoded;
+            REQUIRE(encode(pf, encoded, encodeOptions(encoding, header)));
+            REQUIRE(validate(encoded.data(), encoded.size()).ok());
+
+            // validate() agrees with decode() on every truncation and on random corruption
+            PathFile decoded;
+            for (size_t size = 0; size < encoded.size(); size++) {
+                const ValidationResult result = validate(encoded.data(), size);
+                REQUIRE(result.offset <= size);
+                REQUIRE(result.ok() == decode(encoded.data(), size, decoded));
+            }
+            for (int i = 0; i < 3000; i++) {
+                std::vector<uint8_t> corrupt = encoded;
+                for (int j = rand() % 3; j >= 0; j--) corrupt[rand() % corrupt.size()] = rand();
+                const ValidationResult result = validate(corrupt.data(), corrupt.size());
+                REQUIRE(result.ok() == decode(corrupt.data(), corrupt.size(), decoded));
+            }
+        }
+    }
+
+    // errors point at the field that failed
+    std::vector<uint8_t> file = {0, 1, 0, 'a', 'b', 0, 0, 2, 0, 0, 0, 0x01, 1, 0, 2, 0, 3, 0, 4, 0};
+    REQUIRE_FALSE(validate(file.data(), file.size()).ok());
+    ValidationResult result = validate(file.data(), file.size());
+    REQUIRE(result.error == ValidationError::TruncatedWaypoint);
+    REQUIRE(result.offset == file.size());
+    REQUIRE(std::string(toString(result.error)) == "truncated waypoint");
+    result = validate(file.data(), 4);
+    REQUIRE(result.error == ValidationError::TruncatedName);
+    REQUIRE(result.offset == 3);
+    result = validate(file.data(), 9);
+    REQUIRE(result.error == ValidationError::TruncatedWaypointCount);
+    REQUIRE(result.offset == 7);
+    result = validate(file.data(), 2);
+    REQUIRE(result.error == ValidationError::TruncatedPathCount);
+    REQUIRE(validate(file.data(), 0).error == ValidationError::TruncatedMetadata);
+
+    const std::vector<uint8_t> unknownEncoding = {3, 0x01, 1, 2, 0, 0};
+    result = validate(unknownEncoding.data(), unknownEncoding.size());
+    REQUIRE(result.error == ValidationError::UnknownWaypointEncoding);
+    REQUIRE(result.offset == 3);
+
+    // a delta field of three bytes that does not fit in 16 bits
+    const std::vector<uint8_t> delta = {3, 0x01, 1, 1, 1, 0, 0, 0, 1, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0x7F, 0};
+    result = validate(delta.data(), delta.size());
+    REQUIRE(result.error == ValidationError::MalformedWaypoint);
+    REQUIRE(result.offset == 16);
+    result = validate(delta.data(), delta.size() - 1);
+    REQUIRE(result.error == ValidationError::BlockPastEnd);
+    REQUIRE(result.offset == 12);
+
+    std::vector<uint8_t> encoded;
+    REQUIRE(encode(pf, encoded));
+    encoded[format::fileHeaderSize + 3] ^= 1;
+    result = validate(encoded.data(), encoded.size());
+    REQUIRE(result.error == ValidationError::ChecksumMismatch);
+    REQUIRE(result.offset == format::checksumOffset);
+    encoded[format::versionOffset] = 2;
+    REQUIRE(validate(encoded.data(), encoded.size()).error == ValidationError::UnsupportedVersion);
+    REQUIRE(validate(encoded.data(), 10).error == ValidationError::TruncatedHeader);
+    encoded[format::versionOffset] = format::version;
+    REQUIRE(validate(encoded.data(), encoded.size() - 1).error == ValidationError::TruncatedBody);
+
+    // nothing is allocated
+    REQUIRE(encode(pf, encoded));
+    REQUIRE(countAllocations([&] { REQUIRE(validate(encoded.data(), encoded.size()).ok()); }) == 0);
+}
+
+TEST_CASE("benchmark validate") {
+    PathFile pf = randomPathFile(2000, 500, 1500);
+    std::vector<uint8_t> encoded;
+    PathFile out;
+    for (WaypointEncoding encoding : {WaypointEncoding::Plain, WaypointEncoding::Delta}) {
+        REQUIRE(encode(pf, encoded, encodeOptions(encoding)));
+        const std::string layout = encoding == WaypointEncoding::Plain ? ", plain" : ", delta";
+        std::cout << "validate" << layout << ": "
+                  << gigabytesPerSecond(encoded.size(), 10, [&] { validate(encoded.data(), encoded.size()); })
+                  << " GB/s" << std::endl;
+        BENCHMARK("validate" + layout) { return validate(encoded.data(), encoded.size()).ok(); };
+        BENCHMARK("decode" + layout) {
+            out.paths.clear();
+            return decode(encoded.data(), encoded.size(), out);
+        };
+    }
+}
+
+TEST_CASE("test field decode") {
+    static_assert(std::is_same_v<decltype(PathColumns<WaypointX | WaypointY>::speed), NoColumn>);
+    static_assert(std::is_same_v<decltype(PathColumns<WaypointHeading>::heading), std::vector<uint16_t>>);
+
+    PathFile pf = randomPathFile(10, 0, 200);
+    addUnknownParameters(pf, 3);
+    constexpr unsigned all = WaypointX | WaypointY | WaypointSpeed | WaypointHeading | WaypointLookahead;
+
+    for (WaypointEncoding encoding : {WaypointEncoding::Plain, WaypointEncoding::Delta}) {
+        std::vector<uint8_t> encoded;
+        REQUIRE(encode(pf, encoded, encodeOptions(encoding)));
+
+        std::vector<PathColumns<all>> full;
+        std::vector<PathColumns<WaypointX | WaypointY>> preview;
+        REQUIRE(decode(encoded.data(), encoded.size(), full));
+        REQUIRE(decode(encoded.data(), encoded.size(), preview));
+        REQUIRE(full.size() == pf.paths.size());
+        REQUIRE(preview.size() == pf.paths.size());
+        for (size_t i = 0; i < pf.paths.size(); i++) {
+            const auto& waypoints = pf.paths[i].waypoints;
+            REQUIRE(full[i].name == std::string_view(pf.paths[i].name));
+            REQUIRE(full[i].size() == waypoints.size());
+            REQUIRE(preview[i].size() == waypoints.size());
+            for (size_t j = 0; j < waypoints.size(); j++) {
+                REQUIRE(full[i].x[j] == waypoints[j].x);
+                REQUIRE(full[i].y[j] == waypoints[j].y);
+                REQUIRE(full[i].speed[j] == waypoints[j].speed);
+                REQUIRE(full[i].heading[j] == (waypoints[j].isHeadingAvailable ? waypoints[j].heading : 0));
+                REQUIRE(full[i].lookahead[j] == (waypoints[j].isLookaheadAvailable ? waypoints[j].lookahead : 0));
+                REQUIRE(preview[i].x[j] == waypoints[j].x);
+                REQUIRE(preview[i].y[j] == waypoints[j].y);
+            }
+        }
+
+        // a reused column set does not allocate again
+        PathFileView view(encoded.data(), encoded.size());
+        PathCursor paths = view.paths();
+        PathView p;
+        REQUIRE(paths.next(p));
+        PathColumns<WaypointX | WaypointY> columns;
+        REQUIRE(decode(p, columns));
+        REQUIRE(countAllocations([&] { REQUIRE(decode(p, columns)); }) == 0);
+
+        // truncated files fail like decode()
+        PathFile decoded;
+        for (size_t size = 0; size < encoded.size(); size += 13) {
+            preview.clear();
+            REQUIRE(decode(encoded.data(), size, preview) == decode(encoded.data(), size, decoded));
+        }
+    }
+
+    // runs of one flag go through every kernel, which writes only the requested columns
+    PathFile uniform = uniformPathFile(8, 67);
+    std::vector<uint8_t> encoded;
+    REQUIRE(encode(uniform, encoded));
+    const DecodeKernel best = decodeKernel();
+    for (DecodeKernel kernel : {DecodeKernel::Scalar, DecodeKernel::SSE41, DecodeKernel::AVX2}) {
+        if (!setDecodeKernel(kernel)) continue;
+        std::vector<PathColumns<WaypointY | WaypointHeading>> sparse;
+        REQUIRE(decode(encoded.data(), encoded.size(), sparse));
+        REQUIRE(sparse.size() == uniform.paths.size());
+        for (size_t i = 0; i < uniform.paths.size(); i++) {
+            const auto& waypoints = uniform.paths[i].waypoints;
+            REQUIRE(sparse[i].size() == waypoints.size());
+            for (size_t j = 0; j < waypoints.size(); j++) {
+                REQUIRE(sparse[i].y[j] == waypoints[j].y);
+                REQUIRE(sparse[i].heading[j] == (waypoints[j].isHeadingAvailable ? waypoints[j].heading : 0));
+            }
+        }
+
+        // the mask alone decides the columns written, whatever pointers the others hold
+        PathCursor paths = PathFileView(encoded.data(), encoded.size()).paths();
+        PathView p;
+        for (size_t i = 0; paths.next(p); i++) {
+            ColumnBuffer columns(p.waypointCount());
+            std::fill(columns.x.begin(), columns.x.end(), -7);
+            std::fill(columns.flag.begin(), columns.flag.end(), 0xEE);
+            WaypointCursor waypoints = p.waypoints();
+            REQUIRE(waypoints.read<WaypointY | WaypointHeading>(columns.columns(), p.waypointCount()) ==
+                    p.waypointCount());
+            const auto& w = uniform.paths[i].waypoints;
+            for (size_t j = 0; j < w.size(); j++) {
+                REQUIRE(columns.y[j] == w[j].y);
+                REQUIRE(columns.heading[j] == (w[j].isHeadingAvailable ? w[j].heading : 0));
+                REQUIRE(columns.x[j] == -7);
+                REQUIRE(columns.flag[j] == 0xEE);
+            }
+        }
+    }
+    setDecodeKernel(best);
+}
+
+TEST_CASE("benchmark field decode") {
+    PathFile pf = randomPathFile(200, 500, 1500);
+    std::vector<uint8_t> encoded;
+    REQUIRE(encode(pf, encoded));
+    size_t waypoints = 0;
+    for (const Path& path : pf.paths) waypoints += path.waypoints.size();
+
+    std::cout << "bytes per waypoint: " << sizeof(Waypoint) << " in a Path, " << 5 * sizeof(int16_t)
+              << " in PathColumns of every field, " << 2 * sizeof(int16_t) << " in PathColumns<WaypointX | WaypointY>"
+              << " (" << waypoints << " waypoints)" << std::endl;
+
+    PathFile target;
+    std::vector<PathColumns<WaypointX | WaypointY | WaypointSpeed | WaypointHeading | WaypointLookahead>> full;
+    std::vector<PathColumns<WaypointX | WaypointY>> preview;
+    BENCHMARK("decodeInto, every field") { return decodeInto(encoded.data(), encoded.size(), target); };
+    BENCHMARK("PathColumns, every field") {
+        full.clear();
+        return decode(encoded.data(), encoded.size(), full);
+    };
+    BENCHMARK("PathColumns, x and y") {
+        preview.clear();
+        return decode(encoded.data(), encoded.size(), preview);
+    };
+
+    PathFileView view(encoded.data(), encoded.size());
+    std::vector<PathColumns<WaypointX | WaypointY>> reused(pf.paths.size());
+    BENCHMARK("PathColumns, x and y, reused columns") {
+        PathCursor paths = view.paths();
+        PathView p;
+        for (size_t i = 0; paths.next(p); i++) decode(p, reused[i]);
+        return reused.size();
+    };
+
+    std::vector<uint8_t> uniform;
+    REQUIRE(encode(uniformPathFile(200, 1000), uniform));
+    BENCHMARK("decodeInto, every field, uniform flags") { return decodeInto(uniform.data(), uniform.size(), target); };
+    BENCHMARK("PathColumns, x and y, uniform flags") {
+        preview.clear();
+        return decode(uniform.data(), uniform.size(), preview);
+    };
+}
+
+TEST_CASE("test unit conversion") {
+    static_assert(roundHalfEven(2.5) == 2.0 && roundHalfEven(3.5) == 4.0 && roundHalfEven(2.6f) == 3.0f);
+    static_assert(roundHalfEven(-2.5) == -2.0 && roundHalfEven(-3.5) == -4.0 && roundHalfEven(-0.4) == 0.0);
+    static_assert(toMetres(2000) == 1.0 && toMetresPerSecond(-1000) == -1.0 && toRadians<float>(10000) == 1.0f);
+    static_assert(fromMetres(0.25) == 500 && fromMetres(-0.25f) == -500 && fromRadians(3.0) == 30000);
+    static_assert(fromMetres(100.0) == INT16_MAX && fromMetres(-100.0) == INT16_MIN);
+    static_assert(fromMetresPerSecond(1e9f) == INT16_MAX && fromRadians(-1.0) == 0 && fromRadians(7.0) == UINT16_MAX);
+
+    // every step survives a round trip in both precisions
+    for (int v = INT16_MIN; v <= INT16_MAX; v++) {
+        REQUIRE(fromMetres(toMetres<float>(v)) == v);
+        REQUIRE(fromMetres(toMetres(v)) == v);
+        REQUIRE(fromMetresPerSecond(toMetresPerSecond<float>(v)) == v);
+        REQUIRE(fromRadians(toRadians<float>((uint16_t)v)) == (uint16_t)v);
+        REQUIRE(fromRadians(toRadians((uint16_t)v)) == (uint16_t)v);
+    }
+
+    // the kernels give the same results as the single-value helpers, at every length and for every edge case
+    const size_t count = 1000;
+    std::vector<int16_t> steps(count);
+    std::vector<uint16_t> headings(count);
+    std::vector<double> reals(count);
+    for (size_t i = 0; i < count; i++) {
+        steps[i] = rand();
+        headings[i] = rand();
+        reals[i] = (rand() % 200001 - 100000) / 4000.0; // many ties once scaled
+    }
+    const double edges[] = {NAN, INFINITY, -INFINITY, 1e300, -1e300, -0.0, 0.00025, 16.3835, 16.38375, -16.384};
+    for (size_t i = 0; i < std::size(edges); i++) reals[i * 37] = edges[i];
+    std::vector<float> realsF(reals.begin(), reals.end());
+
+    const DecodeKernel best = decodeKernel();
+    for (DecodeKernel kernel : {DecodeKernel::Scalar, DecodeKernel::SSE41, DecodeKernel::AVX2}) {
+        if (!setDecodeKernel(kernel)) continue;
+        for (size_t n : {(size_t)0, (size_t)1, (size_t)7, (size_t)15, (size_t)17, (size_t)31, count}) {
+            std::vector<float> f(n);
+            std::vector<double> d(n);
+            std::vector<int16_t> q(n), qF(n);
+            std::vector<uint16_t> h(n), hF(n);
+            toMetres(steps.data(), n, f.data());
+            toMetres(steps.data(), n, d.data());
+            for (size_t i = 0; i < n; i++) REQUIRE((f[i] == toMetres<float>(steps[i]) && d[i] == toMetres(steps[i])));
+            toMetresPerSecond(steps.data(), n, f.data());
+            toMetresPerSecond(steps.data(), n, d.data());
+            for (size_t i = 0; i < n; i++) {
+                REQUIRE((f[i] == toMetresPerSecond<float>(steps[i]) && d[i] == toMetresPerSecond(steps[i])));
+            }
+            toRadians(headings.data(), n, f.data());
+            toRadians(headings.data(), n, d.data());
+            for (size_t i = 0; i < n; i++) {
+                REQUIRE((f[i] == toRadians<float>(headings[i]) && d[i] == toRadians(headings[i])));
+            }
+
+            fromMetres(reals.data(), n, q.data());
+            fromMetres(realsF.data(), n, qF.data());
+            for (size_t i = 0; i < n; i++) REQUIRE((q[i] == fromMetres(reals[i]) && qF[i] == fromMetres(realsF[i])));
+            fromMetresPerSecond(reals.data(), n, q.data());
+            fromMetresPerSecond(realsF.data(), n, qF.data());
+            for (size_t i = 0; i < n; i++) {
+                REQUIRE((q[i] == fromMetresPerSecond(reals[i]) && qF[i] == fromMetresPerSecond(realsF[i])));
+            }
+            fromRadians(reals.data(), n, h.data());
+            fromRadians(realsF.data(), n, hF.data());
+            for (size_t i = 0; i < n; i++) REQUIRE((h[i] == fromRadians(reals[i]) && hF[i] == fromRadians(realsF[i])));
+        }
+
+        // waypoints go through the same kernels, across several gather buffers, and keep their other fields
+        for (size_t n : {(size_t)0, (size_t)17, count}) {
+            std::vector<Waypoint> waypoints(n);
+            for (size_t i = 0; i < n; i++) {
+                waypoints[i] = {steps[i], (int16_t)~steps[i], (int16_t)(steps[i] / 2), headings[i], (int16_t)i,
+                                i % 2 != 0, i % 3 == 0};
+            }
+            std::vector<float> f(n);
+            std::vector<double> d(n);
+            toMetres(waypoints.data(), n, &Waypoint::y, f.data());
+            toMetres(waypoints.data(), n, &Waypoint::lookahead, d.data());
+            for (size_t i = 0; i < n; i++) {
+                REQUIRE((f[i] == toMetres<float>(waypoints[i].y) && d[i] == toMetres(waypoints[i].lookahead)));
+            }
+            toMetresPerSecond(waypoints.data(), n, f.data());
+            toRadians(waypoints.data(), n, d.data());
+            for (size_t i = 0; i < n; i++) {
+                REQUIRE(f[i] == toMetresPerSecond<float>(waypoints[i].speed));
+                REQUIRE(d[i] == toRadians(waypoints[i].heading));
+            }
+
+            std::vector<Waypoint> written = waypoints;
+            fromMetres(reals.data(), n, written.data(), &Waypoint::x);
+            fromMetresPerSecond(realsF.data(), n, written.data());
+            fromRadians(reals.data(), n, written.data());
+            for (size_t i = 0; i < n; i++) {
+                REQUIRE(written[i].x == fromMetres(reals[i]));
+                REQUIRE(written[i].speed == fromMetresPerSecond(realsF[i]));
+                REQUIRE(written[i].heading == fromRadians(reals[i]));
+                REQUIRE(written[i].y == waypoints[i].y);
+                REQUIRE(written[i].lookahead == waypoints[i].lookahead);
+                REQUIRE(written[i].isHeadingAvailable == waypoints[i].isHeadingAvailable);
+                REQUIRE(written[i].isLookaheadAvailable == waypoints[i].isLookaheadAvailable);
+            }
+        }
+    }
+    setDecodeKernel(best);
+}
+
+TEST_CASE("benchmark unit conversion") {
+    const size_t count = 1000000;
+    std::vector<int16_t> steps(count);
+    for (int16_t& s : steps) s = rand();
+    std::vector<float> metres(count);
+    std::vector<int16_t> quantized(count);
+
+    BENCHMARK("to metres, 1M floats, hand-written loop") {
+        for (size_t i = 0; i < count; i++) metres[i] = steps[i] * 0.0005f;
+        return metres[count - 1];
+    };
+    BENCHMARK("from metres, 1M floats, hand-written loop") {
+        for (size_t i = 0; i < count; i++) quantized[i] = (int16_t)std::lround(metres[i] * 2000.0f);
+        return quantized[count - 1];
+    };
+
+    const DecodeKernel best = decodeKernel();
+    for (DecodeKernel kernel : {DecodeKernel::Scalar, DecodeKernel::SSE41, DecodeKernel::AVX2}) {
+        if (!setDecodeKernel(kernel)) continue;
+        const std::string name = decodeKernelName(kernel);
+        BENCHMARK("to metres, 1M floats, " + name) {
+            toMetres(steps.data(), count, metres.data());
+            return metres[count - 1];
+        };
+        BENCHMARK("from metres, 1M floats, " + name) {
+            fromMetres(metres.data(), count, quantized.data());
+            return quantized[count - 1];
+        };
+    }
+    setDecodeKernel(best);
+
+    std::vector<Waypoint> waypoints(count);
+    for (size_t i = 0; i < count; i++) waypoints[i].x = steps[i];
+    BENCHMARK("to metres, 1M waypoints, hand-written loop") {
+        for (size_t i = 0; i < count; i++) metres[i] = waypoints[i].x * 0.0005f;
+        return metres[count - 1];
+    };
+    BENCHMARK("to metres, 1M waypoints") {
+        toMetres(waypoints.data(), count, &Waypoint::x, metres.data());
+        return metres[count - 1];
+    };
+    BENCHMARK("from metres, 1M waypoints") {
+        fromMetres(metres.data(), count, waypoints.data(), &Waypoint::x);
+        return waypoints[count - 1].x;
+    };
+}
+
+TEST_CASE("test decode into memory resource") {
+    PathFile pf = randomPathFile(20, 0, 300);
+    std::vector<uint8_t> encoded;
+    REQUIRE(encode(pf, encoded));
+
+    std::vector<uint8_t> arena(1024 * 1024);
+    std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size(), std::pmr::null_memory_resource());
+
+    PathFile pf2(&resource);
+    size_t allocations = countAllocations([&] { REQUIRE(decode(encoded.data(), encoded.size(), pf2)); });
+    REQUIRE(allocations == 0);
+    REQUIRE(pf2.paths.size() == pf.paths.size());
+    for (size_t i = 0; i < pf.paths.size(); i++) {
+        REQUIRE(pf2.paths[i].get_allocator().resource() == &resource);
+        REQUIRE(pf2.paths[i].name == pf.paths[i].name);
+        REQUIRE(pf2.paths[i].waypoints.size() == pf.paths[i].waypoints.size());
+    }
+
+    // copies keep their own allocator unless one is given
+    PathFile copy(pf2, std::pmr::new_delete_resource());
+    REQUIRE(copy.paths[0].get_allocator().resource() == std::pmr::new_delete_resource());
+    PathFile defaultCopy = pf2;
+    REQUIRE(defaultCopy.paths.size() == pf2.paths.size());
+}
+
+TEST_CASE("benchmark decode allocations") {
+    PathFile pf = randomPathFile(100, 1000, 1000);
+    std::vector<uint8_t> encoded;
+    REQUIRE(encode(pf, encoded));
+
+    size_t heap = countAllocations([&] {
+        PathFile out;
+        decode(encoded.data(), encoded.size(), out);
+    });
+
+    std::vector<uint8_t> arena(8 * 1024 * 1024);
+    size_t monotonic = countAllocations([&] {
+        std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size());
+        PathFile out(&resource);
+        decode(encoded.data(), encoded.size(), out);
+    });
+
+    std::cout << "allocations per decode: " << heap << " on the heap, " << monotonic << " with a monotonic arena"
+              << std::endl;
+
+    BENCHMARK("decode, heap") {
+        PathFile out;
+        decode(encoded.data(), encoded.size(), out);
+        return out.paths.size();
+    };
+
+    BENCHMARK("decode, monotonic arena") {
+        std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size());
+        PathFile out(&resource);
+        decode(encoded.data(), encoded.size(), out);
+        return out.paths.size();
+    };
+}
+
+TEST_CASE("test decode into reused storage") {
+    PathFile pf = randomPathFile(30, 0, 300);
+    pf.paths[7].name = std::string(200, 'n'); // too long for the small string buffer
+    std::vector<uint8_t> encoded;
+    REQUIRE(encode(pf, encoded));
+
+    PathFile target;
+    REQUIRE(decodeInto(encoded.data(), encoded.size(), target));
+
+    // steady-state reloads of the same file do not touch the heap
+    for (int i = 0; i < 3; i++) {
+        size_t allocations = countAllocations([&] { REQUIRE(decodeInto(encoded.data(), encoded.size(), target)); });
+        REQUIRE(allocations == 0);
+    }
+
+    REQUIRE(target.paths.size() == pf.paths.size());
+    for (size_t i = 0; i < pf.paths.size(); i++) {
+        REQUIRE(target.paths[i].name == pf.paths[i].name);
+        REQUIRE(target.paths[i].waypoints.size() == pf.paths[i].waypoints.size());
+        for (size_t j = 0; j < pf.paths[i].waypoints.size(); j++)
+            requireSameWaypoint(pf.paths[i].waypoints[j], target.paths[i].waypoints[j]);
+    }
+
+    // a file with fewer paths replaces the contents instead of appending
+    PathFile smaller = randomPathFile(4, 0, 50);
+    REQUIRE(encode(smaller, encoded));
+    REQUIRE(decodeInto(encoded.data(), encoded.size(), target));
+    REQUIRE(target.paths.size() == 4);
+    REQUIRE(target.paths[3].waypoints.size() == smaller.paths[3].waypoints.size());
+
+    // decode() reserves exactly what the header announces
+    PathFile exact;
+    REQUIRE(decode(encoded.data(), encoded.size(), exact));
+    REQUIRE(exact.paths.capacity() == 4);
+    for (size_t i = 0; i < 4; i++) REQUIRE(exact.paths[i].waypoints.capacity() == smaller.paths[i].waypoints.size());
 }